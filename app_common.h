@@ -23,6 +23,7 @@ static const int DEFAULT_SOURCE_MIN = 10;
 static const int DEFAULT_SOURCE_MAX = 150;
 static const int DEFAULT_SOURCE_ITERATIONS = 5;
 static const int DEFAULT_ITEMS_PER_RECORD = 10;
+static const int DEFAULT_RECORDS_PER_BATCH = 1000;
 
 const string KEY_SYNC_INTERVAL = "sync.interval";
 const string KEY_HIST_START = "histogram.start";
@@ -32,6 +33,8 @@ static const string KEY_SOURCE_MIN = "rnd.source.min";
 static const string KEY_SOURCE_MAX = "rnd.source.max";
 static const string KEY_SOURCE_ITERATIONS = "rnd.source.iters";
 static const string KEY_ITEMS_PER_RECORD = "source.items.record";
+//if non-zero, sources emit batches of this many records rather than individual records
+static const string KEY_RECORDS_PER_BATCH = "source.records.batch";
 
 propertiesPtr init_props(){
 
@@ -48,6 +51,7 @@ propertiesPtr init_props(){
         pMap[KEY_SOURCE_MAX] = to_string(DEFAULT_SOURCE_MAX);
         pMap[KEY_SOURCE_ITERATIONS] = to_string(DEFAULT_SOURCE_ITERATIONS);
         pMap[KEY_ITEMS_PER_RECORD] = to_string(DEFAULT_ITEMS_PER_RECORD);
+        pMap[KEY_RECORDS_PER_BATCH] = to_string(DEFAULT_RECORDS_PER_BATCH);
 
         props->add("App.properties", pMap);
         ofstream out("app.properties");
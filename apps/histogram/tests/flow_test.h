@@ -17,6 +17,28 @@ void testFailure();
 void registerTest(string test_name, test_func t);
 void runTests(string label = "Default Flow Tests");
 
+// Sends objects in frames of schema through a single MRNet payload and returns the objects that received
+// deserializes from it, failing the current test if any bytes of the payload are left over
+vector<DataPtr> framesRoundTrip(SchemaPtr schema, SchemaPtr received, const vector<DataPtr>& objects);
+
+// Returns a histogram of numBins bins of width 10 starting at 0, with a count of i * 7 % 100 in bin i
+HistogramPtr getTestHistogram(int numBins);
+
+// Returns the schema of records with an int id, a double value and a float weight, plus a string label if label
+// is set, which is dictionary-encoded if dictionary is set
+RecordSchemaPtr getTestRecordSchema(bool label=false, bool dictionary=false);
+
+// Returns record i of the given test record schema: id i, value i * 0.5, weight i % 7 and label "label-<i % 5>"
+RecordPtr getTestRecord(RecordSchemaPtr schema, int i);
+
+// Runs source into an operator that collects the objects it sends and returns them in order. If numFinished
+// is given it is set to the number of times the collecting operator was told that its stream finished.
+vector<DataPtr> runSource(SharedPtr<SourceOperator> source, int* numFinished=NULL);
+
+// Returns the records in objects, which travel on a stream of the given schema. If it is a RecordBatchSchema
+// the records are taken out of their batches.
+vector<RecordPtr> getRecords(const vector<DataPtr>& objects, SchemaPtr schema);
+
 // Operator that writes received Data objects to a given FILE* using the Schema of its single input stream
 template <class keyType, class valType>
 class TestOutOperator : public AsynchOperator {
@@ -198,16 +198,28 @@ class Record;
 typedef SharedPtr<Record> RecordPtr;
 class RecordSchema;
 typedef SharedPtr<const RecordSchema> ConstRecordSchemaPtr;
+class FixedLayoutCodec;
 class Record : public Data {
   public:
   /*typedef easymap<std::string, DataPtr> fields;
   std::map<std::string, DataPtr> rFields;*/
   // The fields of this record. The labels associated with each field are maintained in the RecordSchema 
   // that this Record is associated with.
-  std::vector<DataPtr> rFields;
+  // For lazy records (see below) the fields that have not been decoded yet are NULL.
+  mutable std::vector<DataPtr> rFields;
+
+  // Records deserialized by a fixed-layout RecordSchema are lazy: rather than decoding every field up front
+  // they keep a copy of the serialized block along with the codec that holds the offset of each field, and
+  // decode a field the first time it is accessed through get() or getFields(). Lazy records that are not
+  // modified are serialized again by copying the block. lazyLayout is NULL for records that are not lazy.
+  // Codecs live in the CodecCache for the lifetime of the process, so a plain pointer is enough.
+  std::vector<char> lazyBlock;
+  const FixedLayoutCodec* lazyLayout;
+
   Record(ConstRecordSchemaPtr schema);
   Record(const std::map<std::string, DataPtr>& label2field, ConstRecordSchemaPtr schema);
   	
+  // Returns all the fields of this record, decoding any that have not been decoded yet
   const std::vector<DataPtr>& getFields() const;
   std::map<std::string, DataPtr> getFieldsMap(ConstRecordSchemaPtr schema) const;
   
@@ -218,6 +230,12 @@ class Record : public Data {
   // NULLDataPtr if this field does not exist.
   DataPtr get(const std::string& label, ConstRecordSchemaPtr schema) const;
 
+  // Returns the field at the given index (see RecordSchema::getIdx), decoding only that field if needed
+  DataPtr get(unsigned int idx) const;
+
+  // Returns whether the fields of this record are decoded on demand from lazyBlock
+  bool isLazy() const { return lazyLayout != NULL; }
+
   // Return whether this object is identical to that object
   // that must have a name that is compatible with this
   bool operator==(const DataPtr& that_arg) const;
@@ -239,8 +257,76 @@ class Record : public Data {
   // Write a human-readable string representation of this object to the given
   // output stream
   std::ostream& str(std::ostream& out, ConstSchemaPtr schema) const;
+
+  protected:
+  // Decodes the field at the given index from lazyBlock
+  void decode(unsigned int idx) const;
 }; // class Record
 
+/***********************
+ ***** RecordBatch *****
+ ***********************/
+
+// A batch of records stored as one contiguous column per field (struct-of-arrays) rather than as
+// individual Records. Column i holds the values of field i (indexed like RecordSchema::field2Idx) of all the
+// records in their native fixed-width representation, so operators can loop over a column as a plain array.
+class RecordBatch;
+typedef SharedPtr<RecordBatch> RecordBatchPtr;
+class RecordBatchSchema;
+typedef SharedPtr<const RecordBatchSchema> ConstRecordBatchSchemaPtr;
+class RecordBatch : public Data {
+  public:
+  // The number of records in the batch
+  unsigned int numRecords;
+  // The number of bytes of each value in each column
+  std::vector<unsigned int> widths;
+  // The columns, each holding numRecords*widths[i] bytes
+  std::vector<std::vector<char> > columns;
+
+  RecordBatch(ConstRecordBatchSchemaPtr schema, unsigned int numRecords=0);
+
+  unsigned int size() const { return numRecords; }
+
+  // Grows or shrinks the batch to hold the given number of records. New records are zero-filled.
+  void resize(unsigned int numRecords);
+
+  // Returns the given column as an array of numRecords values of type T, which must match the type of its field
+  template<class T>
+  T* column(unsigned int idx) {
+    assert(sizeof(T) == widths[idx]);
+    return (T*)columns[idx].data();
+  }
+  template<class T>
+  const T* column(unsigned int idx) const {
+    assert(sizeof(T) == widths[idx]);
+    return (const T*)columns[idx].data();
+  }
+
+  // Appends the fields of the given record, which must be described by the record schema of the batch
+  void append(RecordPtr rec, ConstRecordBatchSchemaPtr schema);
+
+  // Returns a new Record that holds the fields of the record at the given row
+  RecordPtr get(unsigned int row, ConstRecordBatchSchemaPtr schema) const;
+
+  // Return whether this object is identical to that object
+  // that must have a name that is compatible with this
+  bool operator==(const DataPtr& that_arg) const;
+  virtual bool operator==(const RecordBatchPtr& that) const;
+
+  // Return whether this object is strictly less than that object
+  // that must have a name that is compatible with this
+  bool operator<(const DataPtr& that_arg) const;
+  bool operator<(const RecordBatchPtr that) const;
+
+  // Call the parent class's getName call and then Append this class' unique name
+  // to the name list.
+  void getName(std::list<std::string>& name) const;
+
+  // Write a human-readable string representation of this object to the given
+  // output stream
+  std::ostream& str(std::ostream& out, ConstSchemaPtr schema) const;
+}; // class RecordBatch
+
 /******************
  ***** KeyVal *****
  ******************/
@@ -1,5 +1,6 @@
 #pragma once
 #include "operator.h"
+#include "packet_codec.h"
 #include "mrnet/MRNet.h"
 #include "mrnet/Packet.h"
 #include "mrnet/NetworkTopology.h"
@@ -64,22 +65,29 @@ public:
 *****************************************/
 /*
 *
-[|MRNetFilterOut numProperties="1" ]
+[|MRNetFilterOut numProperties="3" name0="compression" val0="..." name1="compression_max_ratio" val1="..."
+        name2="compression_link_bandwidth" val2="..."    ]
 [Operator numProperties="3" name0="ID" val0="3" name1="numInputs" val1="1" name2="numOutputs" val2="0"]
 [/MRNetFilterOut]
 
 
-[|MRNetBackOut numProperties="1" ]
+[|MRNetBackOut numProperties="3" name0="compression" val0="..." name1="compression_max_ratio" val1="..."
+        name2="compression_link_bandwidth" val2="..."    ]
 [Operator numProperties="3" name0="ID" val0="3" name1="numInputs" val1="1" name2="numOutputs" val2="0"]
 [/MRNetBackOut]
 
+* compression is the PacketCodec::codecId that payloads are compressed with, see PacketCompressor for how
+* compression_max_ratio and compression_link_bandwidth (bytes/s, 0 to ignore the cost of compressing) decide
+* whether it pays off. Older configurations without these properties send payloads uncompressed.
 * */
 
 class MRNetFilterOutOperatorConfig: public OperatorConfig {
 public:
-    MRNetFilterOutOperatorConfig(unsigned int ID,propertiesPtr props=NULLProperties);
+    MRNetFilterOutOperatorConfig(unsigned int ID, PacketCodec::codecId codec=PacketCodec::noneCodec,
+            double maxRatio=0.9, double linkBandwidth=0, propertiesPtr props=NULLProperties);
 
-    static propertiesPtr setProperties(propertiesPtr props);
+    static propertiesPtr setProperties(PacketCodec::codecId codec, double maxRatio, double linkBandwidth,
+            propertiesPtr props);
 };
 
 /*****************************************
@@ -88,9 +96,11 @@ public:
 
 class MRNetBackendOutOperatorConfig : public OperatorConfig {
 public:
-    MRNetBackendOutOperatorConfig(unsigned int ID, propertiesPtr props=NULLProperties);
+    MRNetBackendOutOperatorConfig(unsigned int ID, PacketCodec::codecId codec=PacketCodec::noneCodec,
+            double maxRatio=0.9, double linkBandwidth=0, propertiesPtr props=NULLProperties);
 
-    static propertiesPtr setProperties(propertiesPtr props);
+    static propertiesPtr setProperties(PacketCodec::codecId codec, double maxRatio, double linkBandwidth,
+            propertiesPtr props);
 };
 
 
@@ -126,7 +136,18 @@ public:
 class MRNetFilterSourceOperator : public SourceOperator {
 private:
     SchemaPtr schema;
-    StreamBuffer * streamBuf;
+    propertiesPtr schemaProps;
+    // fingerprint that the frames of this schema are tagged with
+    unsigned long long schemaFingerprint;
+    // a separate instance of the schema for each child, indexed by inlet rank, since stateful
+    // encodings such as histogram deltas are decoded relative to what that child sent before
+    std::vector<SchemaPtr> childSchemas;
+    // partial frames received from each child, indexed by inlet rank
+    std::vector<StreamBuffer *> streamBufs;
+    // complete frames decoded from the current packet
+    std::vector<DataPtr> frames;
+    // decompressed form of the current packet, if it was compressed
+    StreamBuffer inflated;
     MRNetInfo mrn_info;
 
 public:
@@ -175,6 +196,12 @@ private:
     // Records whether we need to close the file in the destructor or whether it will be destroyed by users of this Operator
     std::vector<MRN::PacketPtr> *packets_out;
     MRNetInfo mrn_info;
+    // schema fingerprint that outgoing frames are tagged with
+    unsigned long long schemaFingerprint;
+    // compresses outgoing payloads when that pays off
+    PacketCompressor compressor;
+    // compressed form of the current payload
+    StreamBuffer compressed;
 
 public:
     // Loads the Operator from its serialized representation
@@ -220,6 +247,12 @@ private:
     MRN::Stream *stream ;
     MRN::Network *net ;
     bool init;
+    // schema fingerprint that outgoing frames are tagged with
+    unsigned long long schemaFingerprint;
+    // compresses outgoing payloads when that pays off
+    PacketCompressor compressor;
+    // compressed form of the current payload
+    StreamBuffer compressed;
 public:
     // Loads the Operator from its serialized representation
     MRNetBEOutOperator(properties::iterator props);
@@ -274,7 +307,14 @@ private:
     const char * dummy_argv;
     bool init ;
     int num_backends;
+    // fingerprint that the frames of this schema are tagged with
+    unsigned long long schemaFingerprint;
+    // partial frames received from the children
     StreamBuffer * streamBuf;
+    // complete frames decoded from the current packet
+    std::vector<DataPtr> frames;
+    // decompressed form of the current packet, if it was compressed
+    StreamBuffer inflated;
 
     //MRNet specific
     MRN::Network * net;
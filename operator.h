@@ -317,6 +317,50 @@ class SourceOperator: public Operator {
   void streamFinished(unsigned int inStreamIdx) {}
 }; // class SourceOperator
 
+// Reads a range of a file in blocks, keeping up to depth reads in flight so that I/O overlaps with the
+// processing of the blocks that have already arrived. Reads are submitted through io_uring where the kernel
+// supports it and to a pool of threads that call pread() otherwise.
+class AsyncBlockReader {
+  public:
+  typedef enum {uringEngine, preadEngine} engineType;
+
+  static const unsigned int defaultBlockSize = 1024*1024;
+  static const unsigned int defaultDepth = 8;
+
+  private:
+  // The blocks, their reads and the io_uring or pread() threads that serve them (defined in operator.C)
+  class Impl;
+  Impl* impl;
+
+  // Not copyable, since the reads in flight write into impl
+  AsyncBlockReader(const AsyncBlockReader&);
+  AsyncBlockReader& operator=(const AsyncBlockReader&);
+
+  public:
+  // fd: the file to read, which the reader closes when it is destroyed
+  // [start, end): the range of the file to read
+  // blockSize: the size of each read
+  // depth: the maximum number of reads in flight
+  // preferred: the engine to use, io_uring falling back to pread() if the kernel does not support it
+  AsyncBlockReader(int fd, unsigned long start, unsigned long end, unsigned int blockSize=defaultBlockSize,
+                   unsigned int depth=defaultDepth, engineType preferred=uringEngine);
+
+  ~AsyncBlockReader();
+
+  // Returns the next block of the range, in order, and its size, or false after the end of the range.
+  // The block stays valid until the next call to next() or read().
+  bool next(const char** data, size_t* size);
+
+  // Copies up to size bytes of the range that follow those read before into buf, returning their number
+  size_t read(char* buf, size_t size);
+
+  engineType getEngine() const;
+
+  // Opens the named file for reading through an AsyncBlockReader. The returned FILE ends where the objects of
+  // the file do (see IndexedFileReader::dataEnd), cannot be seeked and is closed with fclose().
+  static FILE* open(const char* fName, engineType preferred=uringEngine);
+}; // class AsyncBlockReader
+
 // Operator that reads Data objects from a given FILE* using a given Schema
 class InFileOperator : public SourceOperator {
 
@@ -326,6 +370,30 @@ class InFileOperator : public SourceOperator {
   
   // Records whether we need to close the file in the destructor or whether it will be destroyed by users of this Operator
   bool closeFile;
+
+  // Whether the file is memory-mapped rather than read through inFile, which is then NULL. The whole file is
+  // mapped once and its objects are decoded in place with Schema::deserializeFile(). Files that cannot be
+  // mapped are read through inFile.
+  bool mapped;
+  const char* mapping;
+  size_t mappingSize;
+  // The descriptor of the mapped file, through which pages that were decoded are dropped from the page cache
+  int mappedFd;
+
+  // Opens or maps the file with the given name, as selected by mapped and async
+  void openFile(const char* inFName);
+
+  // Maps the file with the given name, or opens inFile if it cannot be mapped
+  void mapFile(const char* inFName);
+
+  // Sends the objects of the mapped file on the outgoing stream
+  void workMapped();
+
+  // Whether inFile is read through an AsyncBlockReader, which keeps reads in flight while objects are decoded
+  bool async;
+
+  // Sends the objects of the file read by an AsyncBlockReader on the outgoing stream
+  void workAsync();
   
   public:
   // inFile: points to the FILE from which we'll read data
@@ -334,7 +402,9 @@ class InFileOperator : public SourceOperator {
   
   // inFName: the name of the file from which we'll read data
   // schema: the schema of the data from inFile
-  InFileOperator(unsigned int ID, const char* inFName, SchemaPtr schema);
+  // mapped: whether to memory-map the file instead of reading it through stdio
+  // async: whether to read the file through an AsyncBlockReader
+  InFileOperator(unsigned int ID, const char* inFName, SchemaPtr schema, bool mapped=false, bool async=false);
 
   // Loads the Operator from its serialized representation
   InFileOperator(properties::iterator props);
@@ -364,11 +434,219 @@ class InFileOperator : public SourceOperator {
 
 class InFileOperatorConfig: public OperatorConfig {
   public:
-  InFileOperatorConfig(unsigned int ID, const char* inFName, SchemaConfigPtr schemaCfg, propertiesPtr props=NULLProperties);
+  InFileOperatorConfig(unsigned int ID, const char* inFName, SchemaConfigPtr schemaCfg, bool mapped=false, bool async=false,
+                       propertiesPtr props=NULLProperties);
 
-  static propertiesPtr setProperties(const char* inFName, SchemaConfigPtr schemaCfg, propertiesPtr props);
+  static propertiesPtr setProperties(const char* inFName, SchemaConfigPtr schemaCfg, bool mapped, bool async, propertiesPtr props);
 }; // class InFileOperatorConfig
 
+// Decodes the files of a MultiFileInOperator on a pool of threads (defined in operator.C)
+class ParallelFileDecoder;
+
+// Operator that reads Data objects from many files that use the same Schema, decoding them concurrently on a pool
+// of threads and sending them on its single output stream from the thread that calls work(). The objects of each
+// file are sent in order. If ordered, files are sent one after the other in the order of the file list, otherwise
+// the objects of different files are interleaved in whichever order they are decoded.
+class MultiFileInOperator : public SourceOperator {
+  private:
+  // The names of the files to read, after glob expansion
+  std::vector<std::string> inFNames;
+  SchemaPtr schema;
+  bool ordered;
+  unsigned int numThreads;
+  // Whether each file is read through an AsyncBlockReader
+  bool async;
+
+  friend class ParallelFileDecoder;
+
+  // Appends the names of the files that match each pattern to inFNames
+  void expand(const std::vector<std::string>& patterns);
+
+  public:
+  // inFNames: the names of the files from which we'll read data, or glob(3) patterns that match them. The
+  //           files that match a pattern are read in alphabetical order.
+  // schema: the schema of the data in all the files
+  // ordered: whether objects are sent in file order rather than as soon as they are decoded
+  // numThreads: the number of decoding threads, one per core if 0
+  // async: whether each file is read through an AsyncBlockReader
+  MultiFileInOperator(unsigned int ID, const std::vector<std::string>& inFNames, SchemaPtr schema, bool ordered=true,
+                      unsigned int numThreads=0, bool async=false);
+
+  // Loads the Operator from its serialized representation
+  MultiFileInOperator(properties::iterator props);
+
+  // Creates an instance of the Operator from its serialized representation
+  static OperatorPtr create(properties::iterator props);
+
+  // Called to signal that all the incoming streams have been connected. Returns the schemas
+  // of the outgoing streams based on the schemas of the incoming streams.
+  std::vector<SchemaPtr> inConnectionsComplete();
+
+  // Reads all the files and sends their objects on the outgoing stream
+  void work();
+
+  // Returns the names of the files this operator reads
+  const std::vector<std::string>& getFileNames() const { return inFNames; }
+
+  // Write a human-readable string representation of this Operator to the given output stream
+  virtual std::ostream& str(std::ostream& out) const;
+}; // class MultiFileInOperator
+
+class MultiFileInOperatorConfig: public OperatorConfig {
+  public:
+  MultiFileInOperatorConfig(unsigned int ID, const std::vector<std::string>& inFNames, SchemaConfigPtr schemaCfg, bool ordered=true,
+                            unsigned int numThreads=0, bool async=false, propertiesPtr props=NULLProperties);
+
+  static propertiesPtr setProperties(const std::vector<std::string>& inFNames, SchemaConfigPtr schemaCfg, bool ordered,
+                                     unsigned int numThreads, bool async, propertiesPtr props);
+}; // class MultiFileInOperatorConfig
+
+// Operator that parses a text file of delimited values, one record per line, into Records of a given RecordSchema,
+// or into RecordBatches of up to batchSize of them. Fields hold numbers, which are parsed with a fast path for
+// plain decimal notation, or unquoted strings, which batches cannot hold. Lines may end in \r\n and empty lines
+// are skipped. The file is read in large blocks through an AsyncBlockReader. If parallel, the lines of each
+// block are split at line boundaries into chunks that are parsed on the DecodePool, and are sent in order.
+class CSVInFileOperator : public SourceOperator {
+  private:
+  std::string inFName;
+  RecordSchemaPtr schema;
+  char delimiter;
+  bool header;
+  // The field of each column of the file, or "" for columns that are skipped
+  std::vector<std::string> columns;
+  unsigned int batchSize;
+  bool parallel;
+
+  // The schema of the emitted batches if batchSize>0, and the batch that is being filled
+  RecordBatchSchemaPtr batchSchema;
+  RecordBatchPtr pending;
+
+  // The index in schema of the field of each column of the file, -1 for skipped columns, and the type of each field
+  std::vector<int> columnFields;
+  std::vector<ScalarSchema::scalarType> fieldTypes;
+
+  friend class CSVParseTask;
+
+  // Sets columnFields from the given field names of the columns of the file, which come from the header line if fromHeader
+  void mapColumns(const std::vector<std::string>& names, bool fromHeader);
+
+  // Parses the complete lines in [begin, end) and sends their records, skipping the header line if it has
+  // not been seen yet
+  void process(const char* begin, const char* end, bool& headerPending);
+
+  // Parses the lines in [begin, end) into records if batchSize==0 and into batch otherwise
+  void parseLines(const char* begin, const char* end, std::vector<DataPtr>& records, RecordBatchPtr batch) const;
+
+  // Parses the field of the given index from the text in [begin, end) into rec or into the given row of batch
+  void parseField(unsigned int field, const char* begin, const char* end, RecordPtr rec, RecordBatchPtr batch, unsigned int row,
+                  const char* line, const char* lineEnd) const;
+
+  // Sends the given records, or adds the rows of the given batch to pending and sends it whenever it fills up
+  void send(const std::vector<DataPtr>& records, RecordBatchPtr batch);
+
+  public:
+  // The size of the blocks the file is read in
+  static const unsigned int blockSize = 4*1024*1024;
+
+  // inFName: the name of the file from which we'll read data
+  // schema: the schema of the records in inFName, whose fields must be scalars
+  // delimiter: the character that separates the fields of a line
+  // header: whether the first line holds the names of the columns
+  // columns: the field of each column of the file, "" to skip a column. If empty the columns are named by the
+  //          header line if there is one and are the fields of schema in RecordSchema::field2Idx order otherwise.
+  // batchSize: the maximum number of records per emitted RecordBatch, or 0 to emit Records
+  // parallel: whether to parse the lines of each block in parallel
+  CSVInFileOperator(unsigned int ID, const char* inFName, RecordSchemaPtr schema, char delimiter=',', bool header=false,
+                    const std::vector<std::string>& columns=std::vector<std::string>(), unsigned int batchSize=0, bool parallel=false);
+
+  // Loads the Operator from its serialized representation
+  CSVInFileOperator(properties::iterator props);
+
+  // Creates an instance of the Operator from its serialized representation
+  static OperatorPtr create(properties::iterator props);
+
+  // Called to signal that all the incoming streams have been connected. Returns the RecordSchema, or the
+  // RecordBatchSchema of the emitted batches.
+  std::vector<SchemaPtr> inConnectionsComplete();
+
+  // Reads the file and sends its records
+  void work();
+
+  // Parses the given text as a double. Plain decimal numbers with at most 19 significant digits whose value is
+  // exactly representable after scaling by a power of ten up to 1e22 are converted directly, with the same
+  // result as strtod(). Anything else is handed to strtod(). Returns whether the whole text is a number.
+  static bool parseDouble(const char* begin, const char* end, double& value);
+
+  // Write a human-readable string representation of this Operator to the given output stream
+  virtual std::ostream& str(std::ostream& out) const;
+
+  protected:
+  // Sets up the column mapping and the batch schema
+  void init();
+}; // class CSVInFileOperator
+
+class CSVInFileOperatorConfig: public OperatorConfig {
+  public:
+  CSVInFileOperatorConfig(unsigned int ID, const char* inFName, SchemaConfigPtr schemaCfg, char delimiter=',', bool header=false,
+                          const std::vector<std::string>& columns=std::vector<std::string>(), unsigned int batchSize=0,
+                          bool parallel=false, propertiesPtr props=NULLProperties);
+
+  static propertiesPtr setProperties(const char* inFName, SchemaConfigPtr schemaCfg, char delimiter, bool header,
+                                     const std::vector<std::string>& columns, unsigned int batchSize, bool parallel,
+                                     propertiesPtr props);
+}; // class CSVInFileOperatorConfig
+
+// Operator that reads Data objects from a shared-memory ring buffer filled by a simulation on the same node through
+// the C producer API of shm_ring.h. Each message of the ring holds one or more objects serialized with the given
+// Schema, which are decoded where they lie in the ring before the message is released back to the producer. The
+// operator finishes once the producer has closed the ring and every message has been read, and then removes the
+// shared-memory segment.
+class SharedMemInOperator : public SourceOperator {
+  private:
+  // The name of the shared-memory segment, e.g. "/flow_rank0"
+  std::string shmName;
+  SchemaPtr schema;
+  // The number of milliseconds to wait for the producer to create the segment, or -1 to wait forever
+  int attachTimeout;
+  // The number of messages read from the ring
+  unsigned long messagesRead;
+
+  public:
+  // shmName: the name of the shared-memory segment created by the producer
+  // schema: the schema of the objects in the ring
+  // attachTimeout: the number of milliseconds to wait for the producer to create the segment, or -1 for ever
+  SharedMemInOperator(unsigned int ID, const char* shmName, SchemaPtr schema, int attachTimeout=-1);
+
+  // Loads the Operator from its serialized representation
+  SharedMemInOperator(properties::iterator props);
+
+  // Creates an instance of the Operator from its serialized representation
+  static OperatorPtr create(properties::iterator props);
+
+  // Called to signal that all the incoming streams have been connected. Returns the schemas
+  // of the outgoing streams based on the schemas of the incoming streams.
+  std::vector<SchemaPtr> inConnectionsComplete();
+
+  // Attaches to the ring and sends its objects until the producer closes it
+  void work();
+
+  unsigned long getMessagesRead() const { return messagesRead; }
+
+  // Write a human-readable string representation of this Operator to the given output stream
+  virtual std::ostream& str(std::ostream& out) const;
+}; // class SharedMemInOperator
+
+class SharedMemInOperatorConfig: public OperatorConfig {
+  public:
+  SharedMemInOperatorConfig(unsigned int ID, const char* shmName, SchemaConfigPtr schemaCfg, int attachTimeout=-1,
+                            propertiesPtr props=NULLProperties);
+
+  static propertiesPtr setProperties(const char* shmName, SchemaConfigPtr schemaCfg, int attachTimeout, propertiesPtr props);
+}; // class SharedMemInOperatorConfig
+
+// Background thread that writes the buffers of an asynchronous OutFileOperator (defined in operator.C)
+class AsyncFileWriter;
+
 // Operator that writes received Data objects to a given FILE* using the Schema of its single input stream
 class OutFileOperator : public AsynchOperator {
   private:
@@ -376,13 +654,46 @@ class OutFileOperator : public AsynchOperator {
 
   // Records whether we need to close the file in the destructor or whether it will be destroyed by users of this Operator
   bool closeFile;
+
+  // If non-NULL, objects are serialized into in-memory buffers that this thread writes to outFile, so that
+  // work() does not wait on the disk. The file holds the same bytes as when objects are written directly.
+  AsyncFileWriter* writer;
+
+  // Starts the writer if async
+  void initAsync(bool async, unsigned int bufferSize, unsigned int flushInterval, unsigned int maxQueued);
+
+  // Writes all the buffered objects and makes them durable, then stops the writer
+  void finishAsync();
+
+  // Whether an index of the objects is appended to the file when the stream finishes (see IndexedFileReader)
+  bool indexed;
+  // The file offset of each object written so far, if indexed
+  std::vector<unsigned long> offsets;
+  bool indexWritten;
+
+  // Appends the index to the file, if indexed and not done already
+  void writeIndex();
   
   public:
   // outFile: points to the FILE to which we'll write data
-  OutFileOperator(unsigned int ID, FILE* outFile);
+  // async: whether to write from a background thread, handing it buffers of bufferSize bytes or whatever
+  //        has been buffered when flushInterval milliseconds have passed (0 to only hand over full buffers)
+  // maxQueued: the number of full buffers that may wait for the background thread. This bounds the memory
+  //        held by the operator: once that many are queued, work() blocks until the thread has written one,
+  //        so a stream that is persistently faster than the disk is slowed down to the disk's rate.
+  // indexed: whether to append an index of the objects to the file. outFile must then be seekable.
+  OutFileOperator(unsigned int ID, FILE* outFile, bool async=false,
+                  unsigned int bufferSize=defaultBufferSize, unsigned int flushInterval=defaultFlushInterval,
+                  unsigned int maxQueued=defaultMaxQueued, bool indexed=false);
 
   // outFName: the name of the file to which we'll write data
-  OutFileOperator(unsigned int ID, const char* outFName);
+  OutFileOperator(unsigned int ID, const char* outFName, bool async=false,
+                  unsigned int bufferSize=defaultBufferSize, unsigned int flushInterval=defaultFlushInterval,
+                  unsigned int maxQueued=defaultMaxQueued, bool indexed=false);
+
+  static const unsigned int defaultBufferSize = 1024*1024;
+  static const unsigned int defaultFlushInterval = 1000;
+  static const unsigned int defaultMaxQueued = 16;
 
   // Loads the Operator from its serialized representation
   OutFileOperator(properties::iterator props);
@@ -401,6 +712,10 @@ class OutFileOperator : public AsynchOperator {
   // inData: holds the single Data object from the single stream
   // This function may send Data objects on some of the outgoing streams.
   void work(unsigned int inStreamIdx, DataPtr inData);
+
+  // Called when the incoming stream will send no more data. Asynchronous operators write out and fsync all
+  // the buffered objects before returning.
+  void inStreamFinished(unsigned int inStreamIdx);
   
   // Write a human-readable string representation of this Operator to the given output stream
   virtual std::ostream& str(std::ostream& out) const;
@@ -409,11 +724,335 @@ typedef SharedPtr<OutFileOperator> OutFileOperatorPtr;
 
 class OutFileOperatorConfig: public OperatorConfig {
   public:
-  OutFileOperatorConfig(unsigned int ID, const char* outFName, propertiesPtr props=NULLProperties);
-  
-  static propertiesPtr setProperties(const char* outFName, propertiesPtr props);
+  OutFileOperatorConfig(unsigned int ID, const char* outFName, bool async=false,
+                        unsigned int bufferSize=OutFileOperator::defaultBufferSize,
+                        unsigned int flushInterval=OutFileOperator::defaultFlushInterval,
+                        unsigned int maxQueued=OutFileOperator::defaultMaxQueued, bool indexed=false,
+                        propertiesPtr props=NULLProperties);
+  
+  static propertiesPtr setProperties(const char* outFName, bool async, unsigned int bufferSize, unsigned int flushInterval,
+                                     unsigned int maxQueued, bool indexed, propertiesPtr props);
 }; // class OutFileOperatorConfig
 
+// Random access to the objects of a file written by an indexed OutFileOperator. Such files hold the objects
+// followed by their index:
+//   - the offset of each object in the file (unsigned long each)
+//   - a trailer with the number of objects, the fingerprint of their schema, the offset of the index
+//     and a magic string
+// InFileOperators stop reading objects where the index starts.
+class IndexedFileReader {
+  public:
+  // The last bytes of an indexed file
+  struct Trailer {
+    unsigned long numObjects;
+    unsigned long long fingerprint;
+    unsigned long indexOffset;
+    char magic[8];
+  };
+  static const char magic[8];
+
+  private:
+  FILE* in;
+  SchemaPtr schema;
+  std::vector<unsigned long> offsets;
+
+  public:
+  // Opens the named file, which must have been written by an indexed OutFileOperator using a schema with
+  // the same fingerprint as the given one
+  IndexedFileReader(const char* fName, SchemaPtr schema);
+  ~IndexedFileReader();
+
+  // Returns the number of objects in the file
+  unsigned long size() const { return offsets.size(); }
+
+  // Returns the object at the given index
+  DataPtr get(unsigned long idx);
+
+  // Returns count objects starting at the given index
+  std::vector<DataPtr> get(unsigned long first, unsigned long count);
+
+  // Reads the trailer of a file of the given size whose last sizeof(Trailer) bytes are given, returning whether
+  // it is an indexed file
+  static bool parseTrailer(const char* last, unsigned long fileSize, Trailer& trailer);
+
+  // Returns the offset at which the objects of the given file end: the start of its index if it has one, its
+  // size otherwise, or ULONG_MAX if it cannot be determined (e.g. for pipes). The file position is unchanged.
+  static unsigned long dataEnd(FILE* f);
+}; // class IndexedFileReader
+
+// Columnar files hold records of fixed-width scalars in blocks of up to blockSize records. Each block stores
+// the values of each column contiguously, in RecordSchema::field2Idx order. The blocks are followed by a footer
+// with the offset, the number of records and the minimum and maximum value of each column of each block, and
+// a trailer that locates the footer. Readers can thus skip the blocks whose statistics rule out a predicate
+// and read only the columns they need.
+class ColumnarFile {
+  public:
+  // The statistics of one block
+  class Block {
+    public:
+    unsigned long offset;
+    unsigned int numRecords;
+    // The smallest and largest value of each column, compared as doubles. NaNs are ignored.
+    std::vector<double> min, max;
+  };
+
+  // The last bytes of a columnar file
+  struct Trailer {
+    unsigned long numBlocks;
+    unsigned int numColumns;
+    unsigned int blockSize;
+    unsigned long long fingerprint;
+    unsigned long footerOffset;
+    char magic[8];
+  };
+  static const char magic[8];
+
+  // Stores the given values of a column of the given type as doubles
+  static void widen(const char* values, ScalarSchema::scalarType type, unsigned int numValues, double* out);
+}; // class ColumnarFile
+
+// Operator that writes the Records or RecordBatches it receives to a columnar file (see ColumnarFile)
+class ColumnarOutFileOperator : public AsynchOperator {
+  private:
+  FILE* outFile;
+  unsigned int blockSize;
+
+  // The schema of the blocks and the records that have not been written yet
+  RecordBatchSchemaPtr batchSchema;
+  RecordBatchPtr pending;
+
+  // The blocks written so far
+  std::vector<ColumnarFile::Block> blocks;
+  bool finished;
+
+  // Appends count rows of the given batch, starting at row first, to pending, writing blocks as they fill up
+  void append(RecordBatchPtr batch, unsigned int first, unsigned int count);
+
+  // Writes the pending records as a block
+  void writeBlock();
+
+  // Writes the last block, the footer and the trailer
+  void finish();
+
+  public:
+  static const unsigned int defaultBlockSize = 64*1024;
+
+  // outFName: the name of the file to which we'll write data
+  // blockSize: the maximum number of records per block
+  ColumnarOutFileOperator(unsigned int ID, const char* outFName, unsigned int blockSize=defaultBlockSize);
+
+  // Loads the Operator from its serialized representation
+  ColumnarOutFileOperator(properties::iterator props);
+
+  // Creates an instance of the Operator from its serialized representation
+  static OperatorPtr create(properties::iterator props);
+
+  ~ColumnarOutFileOperator();
+
+  // Called to signal that all the incoming streams have been connected. The incoming stream must carry
+  // Records of fixed-width scalars or RecordBatches.
+  std::vector<SchemaPtr> inConnectionsComplete();
+
+  // Called when a Record or a RecordBatch arrives on the single incoming stream
+  void work(unsigned int inStreamIdx, DataPtr inData);
+
+  // Called when the incoming stream will send no more data. Completes the file.
+  void inStreamFinished(unsigned int inStreamIdx);
+
+  // Write a human-readable string representation of this Operator to the given output stream
+  virtual std::ostream& str(std::ostream& out) const;
+}; // class ColumnarOutFileOperator
+
+class ColumnarOutFileOperatorConfig: public OperatorConfig {
+  public:
+  ColumnarOutFileOperatorConfig(unsigned int ID, const char* outFName, unsigned int blockSize=ColumnarOutFileOperator::defaultBlockSize,
+                                propertiesPtr props=NULLProperties);
+
+  static propertiesPtr setProperties(const char* outFName, unsigned int blockSize, propertiesPtr props);
+}; // class ColumnarOutFileOperatorConfig
+
+// A predicate that holds for the records whose given field lies within [min, max]. It holds for all records
+// if field is empty.
+class ColumnRange {
+  public:
+  std::string field;
+  double min, max;
+
+  ColumnRange();
+  ColumnRange(const std::string& field, double min, double max);
+}; // class ColumnRange
+
+// Operator that reads a columnar file and emits, for each block, a RecordBatch of the records that satisfy
+// a predicate. Blocks whose statistics show that none of their records can satisfy it are not read, and only
+// the columns of the output and of the predicate are read from the other blocks.
+class ColumnarInFileOperator : public SourceOperator {
+  private:
+  std::string inFName;
+  // The schema of the records in the file
+  RecordSchemaPtr schema;
+  // The fields to emit, all of them if empty
+  std::vector<std::string> columns;
+  ColumnRange predicate;
+
+  // The schema of the emitted batches
+  RecordBatchSchemaPtr outSchema;
+
+  // The number of blocks read and skipped by work()
+  unsigned long blocksRead, blocksSkipped;
+
+  public:
+  // inFName: the name of the file from which we'll read data
+  // schema: the schema of the records in inFName
+  // columns: the fields that the emitted batches hold, all of them if empty
+  // predicate: the records to emit
+  ColumnarInFileOperator(unsigned int ID, const char* inFName, RecordSchemaPtr schema,
+                         const std::vector<std::string>& columns=std::vector<std::string>(),
+                         const ColumnRange& predicate=ColumnRange());
+
+  // Loads the Operator from its serialized representation
+  ColumnarInFileOperator(properties::iterator props);
+
+  // Creates an instance of the Operator from its serialized representation
+  static OperatorPtr create(properties::iterator props);
+
+  // Called to signal that all the incoming streams have been connected. Returns the RecordBatchSchema of
+  // the emitted batches.
+  std::vector<SchemaPtr> inConnectionsComplete();
+
+  // Reads the file and emits its matching records
+  void work();
+
+  unsigned long getBlocksRead() const { return blocksRead; }
+  unsigned long getBlocksSkipped() const { return blocksSkipped; }
+
+  // Write a human-readable string representation of this Operator to the given output stream
+  virtual std::ostream& str(std::ostream& out) const;
+
+  protected:
+  // Builds outSchema from schema and columns
+  void initOutSchema();
+}; // class ColumnarInFileOperator
+
+class ColumnarInFileOperatorConfig: public OperatorConfig {
+  public:
+  ColumnarInFileOperatorConfig(unsigned int ID, const char* inFName, SchemaConfigPtr schemaCfg,
+                               const std::vector<std::string>& columns=std::vector<std::string>(),
+                               const ColumnRange& predicate=ColumnRange(), propertiesPtr props=NULLProperties);
+
+  static propertiesPtr setProperties(const char* inFName, SchemaConfigPtr schemaCfg, const std::vector<std::string>& columns,
+                                     const ColumnRange& predicate, propertiesPtr props);
+}; // class ColumnarInFileOperatorConfig
+
+// Capture files hold the objects of a stream with the time at which each arrived, so that the stream can be
+// replayed later at its recorded pace. They start with a Header, followed by one frame per object:
+//   - the number of nanoseconds between the arrival of the first object and this one (unsigned long long)
+//   - the size of the serialized object (unsigned int)
+//   - the object, serialized with the schema of the stream
+class CaptureFile {
+  public:
+  struct Header {
+    char magic[8];
+    unsigned long long fingerprint;
+  };
+  static const char magic[8];
+
+  // Returns the current time in nanoseconds on a clock that never goes backwards
+  static unsigned long long now();
+}; // class CaptureFile
+
+// Operator that records the objects of its single incoming stream, and the time at which each arrived, in a
+// capture file that a ReplayInFileOperator can later play back
+class CaptureOutFileOperator : public AsynchOperator {
+  private:
+  FILE* outFile;
+  SchemaPtr schema;
+  // The arrival time of the first object
+  unsigned long long start;
+  unsigned long numObjects;
+  // The object being written, serialized
+  StreamBuffer buffer;
+
+  public:
+  // outFName: the name of the file to which we'll write data
+  CaptureOutFileOperator(unsigned int ID, const char* outFName);
+
+  // Loads the Operator from its serialized representation
+  CaptureOutFileOperator(properties::iterator props);
+
+  // Creates an instance of the Operator from its serialized representation
+  static OperatorPtr create(properties::iterator props);
+
+  ~CaptureOutFileOperator();
+
+  // Called to signal that all the incoming streams have been connected. Writes the header of the file.
+  std::vector<SchemaPtr> inConnectionsComplete();
+
+  // Called when an object arrives on the single incoming stream
+  void work(unsigned int inStreamIdx, DataPtr inData);
+
+  // Called when the incoming stream will send no more data. Writes out and fsyncs the file.
+  void inStreamFinished(unsigned int inStreamIdx);
+
+  unsigned long getNumObjects() const { return numObjects; }
+
+  // Write a human-readable string representation of this Operator to the given output stream
+  virtual std::ostream& str(std::ostream& out) const;
+}; // class CaptureOutFileOperator
+
+class CaptureOutFileOperatorConfig: public OperatorConfig {
+  public:
+  CaptureOutFileOperatorConfig(unsigned int ID, const char* outFName, propertiesPtr props=NULLProperties);
+
+  static propertiesPtr setProperties(const char* outFName, propertiesPtr props);
+}; // class CaptureOutFileOperatorConfig
+
+// Operator that plays back the objects of a capture file. Each object is sent once the time that passed since
+// the first one was sent matches the time recorded between them, divided by speed: 1 replays the stream at its
+// recorded pace, 2 twice as fast, and 0 sends the objects as fast as possible.
+class ReplayInFileOperator : public SourceOperator {
+  private:
+  std::string inFName;
+  SchemaPtr schema;
+  double speed;
+
+  // The number of objects that were sent after their scheduled time and the largest delay, in nanoseconds
+  unsigned long numLate;
+  unsigned long long maxDelay;
+
+  public:
+  // inFName: the name of the capture file from which we'll read data
+  // schema: the schema of the stream that was captured
+  // speed: how many times faster than it was recorded to replay the stream, or 0 for as fast as possible
+  ReplayInFileOperator(unsigned int ID, const char* inFName, SchemaPtr schema, double speed=1);
+
+  // Loads the Operator from its serialized representation
+  ReplayInFileOperator(properties::iterator props);
+
+  // Creates an instance of the Operator from its serialized representation
+  static OperatorPtr create(properties::iterator props);
+
+  // Called to signal that all the incoming streams have been connected. Returns the schemas
+  // of the outgoing streams based on the schemas of the incoming streams.
+  std::vector<SchemaPtr> inConnectionsComplete();
+
+  // Sends the objects of the file at the selected pace
+  void work();
+
+  unsigned long getNumLate() const { return numLate; }
+  unsigned long long getMaxDelay() const { return maxDelay; }
+
+  // Write a human-readable string representation of this Operator to the given output stream
+  virtual std::ostream& str(std::ostream& out) const;
+}; // class ReplayInFileOperator
+
+class ReplayInFileOperatorConfig: public OperatorConfig {
+  public:
+  ReplayInFileOperatorConfig(unsigned int ID, const char* inFName, SchemaConfigPtr schemaCfg, double speed=1,
+                             propertiesPtr props=NULLProperties);
+
+  static propertiesPtr setProperties(const char* inFName, SchemaConfigPtr schemaCfg, double speed, propertiesPtr props);
+}; // class ReplayInFileOperatorConfig
+
 
 // Operator that computes the join of the KeyValMap objects on all the incoming streams and
 // emits ExplicitKeyValMap objects for each joined key->value pair
@@ -649,15 +1288,24 @@ private:
     double range_start, range_stop;
     //width for a histogram bin
     double bin_width;
+    //layout of the emitted histograms on MRNet streams
+    HistogramSchema::encodingType encoding;
+    //if non-zero, successive histograms are sent as deltas with a full histogram at least this often
+    unsigned int deltaInterval;
     // The schema of the incoming streams. All streams must use the same schema.
     //this will be defined from the incoming stream
     RecordSchemaPtr schema;
+    //set if the incoming streams carry batches of records of the above schema rather than individual records
+    RecordBatchSchemaPtr batchSchema;
+    //the scalar type of each field of schema, indexed like the fields of its records
+    std::vector<ScalarSchema::scalarType> fieldTypes;
 
     // The schema of the key->value mappings that will be emitted by this operator
     HistogramSchemaPtr outputHistogramSchema;
 
 public:
-    SynchedRecordJoinOperator(unsigned int numInputs, unsigned int ID, double start, double stop, double width);
+    SynchedRecordJoinOperator(unsigned int numInputs, unsigned int ID, double start, double stop, double width,
+            HistogramSchema::encodingType encoding=HistogramSchema::genericEnc, unsigned int deltaInterval=0);
 
     // Loads the Operator from its serialized representation
     SynchedRecordJoinOperator(properties::iterator props);
@@ -686,14 +1334,19 @@ public:
 
     // Write a human-readable string representation of this Operator to the given output stream
     std::ostream& str(std::ostream& out) const;
+
+private:
+    //add the n values of a batch column to the per-bin counts
+    template <class NumType>
+    void binColumn(const NumType* values, unsigned int n, std::vector<int>& counts) const;
 };
 
 /*****************************************
 * SynchedRecordJoin config
 *****************************************/
 /*
-[|SynchedRecordJoin numProperties="3" name0="start" val0="..." name1="stop" val0=""
-        name2="bin_width" val2=""      ]
+[|SynchedRecordJoin numProperties="5" name0="start" val0="..." name1="stop" val0=""
+        name2="bin_width" val2="" name3="histogram_encoding" val3="" name4="histogram_delta_interval" val4=""      ]
 [Operator numProperties="3" name0="ID" val0="0" name1="numInputs" val1="0" name2="numOutputs" val2="1"]
 
 [/SynchedRecordJoin]
@@ -703,10 +1356,11 @@ public:
 class SynchedRecordJoinOperatorConfig: public OperatorConfig {
 public:
     SynchedRecordJoinOperatorConfig(unsigned int numInputs, unsigned int ID,  double start, double stop, double width,
+             HistogramSchema::encodingType encoding=HistogramSchema::genericEnc, unsigned int deltaInterval=0,
              propertiesPtr props=NULLProperties);
 
     static propertiesPtr setProperties(  double start, double stop, double width,
-            propertiesPtr props);
+            HistogramSchema::encodingType encoding, unsigned int deltaInterval, propertiesPtr props);
 };
 
 
@@ -724,6 +1378,8 @@ private:
     int rnd_min ;
     int rnd_max ;
     int maxIters;
+    //number of records in each batch generated when the schema is a RecordBatchSchema
+    unsigned int batchSize;
 
 public:
     typedef enum {RAND_SRC} source_type;
@@ -744,8 +1400,10 @@ public:
         list<DataPtr>&produce();
     };
     // type: points to the FILE from which we'll read data
-    // schema: the schema of the data from inFile
-    InMemorySourceOperator(unsigned int ID, unsigned int type, int rnd_min, int rnd_max, int max_iters, SchemaPtr schema);
+    // schema: the schema of the data from inFile. If it is a RecordBatchSchema each iteration emits one
+    //         RecordBatch of batchSize records, otherwise one Record.
+    InMemorySourceOperator(unsigned int ID, unsigned int type, int rnd_min, int rnd_max, int max_iters, SchemaPtr schema,
+            unsigned int batchSize=1);
 
     // Loads the Operator from its serialized representation
     InMemorySourceOperator(properties::iterator props);
@@ -779,8 +1437,8 @@ public:
 * InMemorySource config
 *****************************************/
 /*
-[|InMemorySource numProperties="3" name0="srcType" val0="..." name1="maxIterations" val1=".."
-        name2="rndMax" val2=".." name2="rndMin" val2=".."     ]
+[|InMemorySource numProperties="5" name0="srcType" val0="..." name1="maxIterations" val1=".."
+        name2="rndMax" val2=".." name3="rndMin" val3=".." name4="batchSize" val4=".."     ]
 [Operator numProperties="3" name0="ID" val0="0" name1="numInputs" val1="0" name2="numOutputs" val2="1"]
 [schema]
 ...
@@ -791,9 +1449,11 @@ public:
 
 class InMemorySourceOperatorConfig: public OperatorConfig {
 public:
-    InMemorySourceOperatorConfig(unsigned int ID, unsigned int type, int iters, int rnd_min, int rnd_max, SchemaConfigPtr schemaCfg, propertiesPtr props=NULLProperties);
+    InMemorySourceOperatorConfig(unsigned int ID, unsigned int type, int iters, int rnd_min, int rnd_max, SchemaConfigPtr schemaCfg,
+            unsigned int batchSize=1, propertiesPtr props=NULLProperties);
 
-    static propertiesPtr setProperties(unsigned int type, int iters, int rnd_min, int rnd_max, SchemaConfigPtr schemaCfg, propertiesPtr props);
+    static propertiesPtr setProperties(unsigned int type, int iters, int rnd_min, int rnd_max, SchemaConfigPtr schemaCfg,
+            unsigned int batchSize, propertiesPtr props);
 
 };
 
@@ -808,6 +1468,10 @@ private:
 
     // The schema of the key->value mappings that will be input and emitted by this operato
     HistogramSchemaPtr schema;
+    //if non-zero, the output is sent as histogram deltas with a full histogram at least this often
+    unsigned int deltaInterval;
+    // The schema of the outgoing stream, the incoming schema unless deltas are enabled
+    HistogramSchemaPtr outSchema;
     //buffer queue that will keep data
     std::vector<DataPtr> dataBuffer;
 
@@ -816,12 +1480,12 @@ private:
 
 public:
 
-    SynchedHistogramJoinOperator(unsigned int numInputs, unsigned int ID, int interval);
+    SynchedHistogramJoinOperator(unsigned int numInputs, unsigned int ID, int interval, unsigned int deltaInterval=0);
 
     // Loads the Operator from its serialized representation
     SynchedHistogramJoinOperator(properties::iterator props);
 
-    void init(int);
+    void init(int, unsigned int);
 
     // Creates an instance of the Operator from its serialized representation
     static OperatorPtr create(properties::iterator props);
@@ -852,7 +1516,7 @@ public:
 *****************************************/
 
 /*
-[|SynchedHistogramJoin numProperties="1" name0="sync_interval" val0="..."    ]
+[|SynchedHistogramJoin numProperties="2" name0="interval" val0="..." name1="histogram_delta_interval" val1="..."    ]
 [Operator numProperties="3" name0="ID" val0="0" name1="numInputs" val1="1" name2="numOutputs" val2="1"]
 
 [/SynchedHistogramJoin]
@@ -861,8 +1525,9 @@ public:
 
 class SynchedHistogramJoinOperatorConfig: public OperatorConfig {
 public:
-    SynchedHistogramJoinOperatorConfig(unsigned int ID, int interval, propertiesPtr props=NULLProperties);
+    SynchedHistogramJoinOperatorConfig(unsigned int ID, int interval, unsigned int deltaInterval=0,
+            propertiesPtr props=NULLProperties);
 
-    static propertiesPtr setProperties(int interval, propertiesPtr props);
+    static propertiesPtr setProperties(int interval, unsigned int deltaInterval, propertiesPtr props);
 
 };
\ No newline at end of file
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "schema.h"
+
+/*
+* Compression of the payloads that the MRNet operators send. Each payload starts with the one byte id
+* of the codec it was encoded with:
+*   noneCodec - followed by the serialized frames as they are
+*   lzCodec   - followed by the varint size of the serialized frames and then their compressed form
+* Receivers decode whatever codec a payload was sent with, so senders may switch codecs per packet.
+* */
+class PacketCodec {
+public:
+    typedef enum {noneCodec=0, lzCodec=1} codecId;
+
+    // Number of bytes senders reserve in front of the serialized frames for the codec id
+    static const int headerSize = 1;
+
+    virtual ~PacketCodec() {}
+
+    virtual codecId id() const=0;
+
+    // Returns an upper bound on the size of the compressed form of size bytes
+    virtual unsigned int maxCompressedSize(unsigned int size) const=0;
+
+    // Compresses the size bytes at in into out, which must have room for maxCompressedSize(size) bytes.
+    // Returns the size of the compressed form.
+    virtual unsigned int compress(const char* in, unsigned int size, char* out) const=0;
+
+    // Decompresses the size bytes at in into the rawSize bytes at out. Returns false if the compressed
+    // form is corrupt or does not decompress to exactly rawSize bytes.
+    virtual bool decompress(const char* in, unsigned int size, char* out, unsigned int rawSize) const=0;
+
+    // Returns the codec with the given id, or NULL if there is no such codec
+    static const PacketCodec* get(codecId id);
+
+    // Starts an outgoing payload in buffer, which must be empty, by writing the noneCodec id.
+    // The serialized frames are then written after it.
+    static void beginPayload(StreamBuffer* buffer);
+
+    // Decodes a received payload into the serialized frames it holds. On return frames/framesSize
+    // point either into the payload itself or, for compressed payloads, into scratch.
+    static void decodePayload(const char* payload, int size, const char** frames, int* framesSize,
+                              StreamBuffer* scratch);
+}; // class PacketCodec
+
+/*
+* Byte-oriented LZ77 codec with the sequence layout of the LZ4 block format: a token byte that holds the
+* number of literals in its high nibble and the match length minus 4 in its low one (15 in either means
+* that more length bytes of 255 follow), the literals, a little-endian 16 bit offset back to the match
+* and the extra match length bytes. The last sequence has literals only. Matches are found with a single
+* hash probe per position, favouring speed over ratio.
+* */
+class LZPacketCodec : public PacketCodec {
+public:
+    codecId id() const { return lzCodec; }
+
+    unsigned int maxCompressedSize(unsigned int size) const;
+
+    unsigned int compress(const char* in, unsigned int size, char* out) const;
+
+    bool decompress(const char* in, unsigned int size, char* out, unsigned int rawSize) const;
+}; // class LZPacketCodec
+
+/*
+* Sender side of the packet compression. Payloads are compressed with the configured codec unless that
+* does not pay off:
+* - payloads smaller than minSize are always sent as they are
+* - the compressed payload may be at most maxRatio of the size of the raw one
+* - if linkBandwidth (bytes/s) is non-zero, compressing a payload must take less time than sending the
+*   bytes it saves over the link would
+* Whenever compression does not pay off it is bypassed for the next backoff payloads. backoff doubles
+* with each consecutive miss, up to maxBackoff, and drops back to 1 once compression pays off again.
+* */
+class PacketCompressor {
+public:
+    PacketCodec::codecId codec;
+    double maxRatio;
+    double linkBandwidth;
+    unsigned int minSize;
+
+    static const unsigned int maxBackoff = 1024;
+
+    // Running totals over all payloads passed to finishPayload()
+    unsigned long payloads, compressedPayloads, rawBytes, sentBytes;
+
+    PacketCompressor(PacketCodec::codecId codec=PacketCodec::noneCodec, double maxRatio=0.9,
+                     double linkBandwidth=0, unsigned int minSize=256);
+
+    // Given a payload started with PacketCodec::beginPayload() and followed by the serialized frames,
+    // returns the buffer that holds the payload to send: either payload itself or scratch, into which
+    // its compressed form was written.
+    StreamBuffer* finishPayload(StreamBuffer* payload, StreamBuffer* scratch);
+
+protected:
+    // Number of payloads left to send uncompressed before compression is tried again
+    unsigned int bypass;
+    unsigned int backoff;
+
+    // Records that compression did not pay off
+    void miss();
+}; // class PacketCompressor
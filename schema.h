@@ -4,7 +4,9 @@
 #include "data.h"
 #include <vector>
 #include <map>
+#include <unordered_map>
 #include <boost/enable_shared_from_this.hpp>
+#include <boost/function.hpp>
 #include <boost/thread/tss.hpp>
 
 using namespace sight;
@@ -38,25 +40,37 @@ class SchemaConfig;
 typedef SharedPtr<SchemaConfig> SchemaConfigPtr;
 
 /**
-* A circular streaming buffer for the stream operators
-*  adaptive - change size of buffer depending on the current total
+* A contiguous, growable byte queue that serialized Data objects are streamed through
+*  - bytes are appended at seek and consumed from start, so the unread bytes always lie in [start, seek)
+*  - when the room after seek runs out, the unread bytes are moved back to the front of the buffer if
+*    that frees enough space cheaply, otherwise the buffer is reallocated to a larger capacity
+*  - the buffer is either owned by the StreamBuffer or wraps memory provided by the caller. Caller memory
+*    is never freed or reallocated: once it is outgrown the contents move to memory owned by the StreamBuffer
 */
 class StreamBuffer {
     public:
     //holding buffer for the incoming/outgoing stream
     const char* buffer;
-    //total size of current stream
+    //number of unread bytes currently held in the buffer
     int current_total_size;
-    //current maximum size allowed on the stream
+    //current capacity of the buffer
     int max_size;
 
-    //end position
+    //end position (next byte to be written)
     int seek ;
-    //start position of the sttream
+    //start position of the stream (next byte to be read)
     int start ;
 
+    //whether buffer was allocated by this StreamBuffer and must be released by it
+    bool owned;
+    //whether the buffer may only be read from (see StreamBufferView)
+    bool readOnly;
+
+    // Wraps the given max_size bytes of caller-provided memory
     StreamBuffer(const char* out, int max_size){
         this->buffer = out ;
+        this->owned = false;
+        this->readOnly = false;
         //init sizes
         this->max_size = max_size;
         this->current_total_size = 0 ;
@@ -65,16 +79,63 @@ class StreamBuffer {
         start = 0 ;
     }
 
-    ~StreamBuffer(){
-//        delete (char*)buffer;
-    }
+    // Allocates a buffer with the given initial capacity
+    StreamBuffer(int capacity=4096);
+
+    ~StreamBuffer();
+
+    // Number of unread bytes
+    int size() const { return current_total_size; }
+
+    // Number of bytes the buffer can hold without growing
+    int capacity() const { return max_size; }
+
+    // Returns a pointer to the first unread byte
+    const char* data() const { return buffer + start; }
+
+    // Makes sure that at least n more bytes can be written contiguously after seek
+    void reserve(int n);
+
+    // Moves the unread bytes to the front of the buffer
+    void compact();
+
+    // Discards all the unread bytes
+    void clear() { current_total_size = 0; seek = 0; start = 0; }
+
+    // Returns a pointer to where the next byte will be written. reserve() must make room first.
+    char* tail() { return (char*)buffer + seek; }
 
+    // Marks the n bytes that were written at tail() as unread
+    void advance(int n) { seek += n; current_total_size += n; }
+
+    // Hands the buffer, compacted so that the unread bytes start at offset 0, over to the caller,
+    // who becomes responsible for free()ing it. The StreamBuffer is left empty.
+    char* release();
+
+    private:
+    // StreamBuffers own raw memory and may not be copied
+    StreamBuffer(const StreamBuffer&);
+    StreamBuffer& operator=(const StreamBuffer&);
+} ;
+
+/**
+* A read-only StreamBuffer over bytes owned by someone else (e.g. the payload of a received MRNet packet).
+* All size bytes are initially unread, so Schema::deserialize() decodes them in place without first
+* copying them into a StreamBuffer of its own.
+*/
+class StreamBufferView : public StreamBuffer {
+    public:
+    StreamBufferView(const char* data, int size) : StreamBuffer(data, size) {
+        current_total_size = size;
+        seek = size;
+        readOnly = true;
+    }
 } ;
 
 class Schema {
   public:
-  Schema() {}
-  Schema(properties::iterator props) {}
+  Schema() : fingerprintCache(0) {}
+  Schema(properties::iterator props) : fingerprintCache(0) {}
   	
   // Return whether this object is identical to that object
   virtual bool operator==(const SchemaPtr& that) const=0;
@@ -91,28 +152,86 @@ class Schema {
   virtual void serialize(DataPtr obj, FILE* out) const=0;
 
 
-    /*  each time a data portion is serialized check if currently 'bytes_written' > size/2
-    *   - if true resize buffer to size*2
-    *
-    *  memcopy 'data' to updated (or not) buffer allocation 'buffer'
+    /*  appends 'size' bytes of 'data' to the buffer with a single memcpy, growing or compacting
+    *   the buffer first if there is not enough room after its end position
     *
-    *  return - number of bytes written
+    *  return - number of unread bytes in the buffer after the write
     *  */
   static int bufwrite(const void* data, int size, StreamBuffer * buffer);
 
+    /*  copies 'size' bytes from the start of the buffer into 'data' with a single memcpy
+    *
+    *  return - 1 on success, -1 if fewer than 'size' bytes are available (nothing is consumed)
+    *  */
   static int bufread(void* data, int size, StreamBuffer * buffer);
 
   static int bufgetc(StreamBuffer * buffer);
 
+    /*  copies 'size' bytes from the start of the buffer into 'data' without consuming them
+    *
+    *  return - 1 on success, -1 if fewer than 'size' bytes are available
+    *  */
+  static int bufpeek(void* data, int size, StreamBuffer * buffer);
+
+    /*  consumes 'size' bytes from the start of the buffer without copying them
+    *
+    *  return - 1 on success, -1 if fewer than 'size' bytes are available (nothing is consumed)
+    *  */
+  static int bufskip(int size, StreamBuffer * buffer);
+
+    /*  appends 'value' to the buffer as a LEB128 varint: 7 bits per byte, low bits first, with the
+    *   high bit of each byte set if more bytes follow
+    *
+    *  return - number of unread bytes in the buffer after the write
+    *  */
+  static int bufwriteVarint(unsigned long value, StreamBuffer * buffer);
+
+    /*  reads a LEB128 varint from the start of the buffer into 'value'
+    *
+    *  return - 1 on success, -1 if the buffer ends before the varint does (nothing is consumed)
+    *  */
+  static int bufreadVarint(unsigned long * value, StreamBuffer * buffer);
+
+  // Returns the number of bytes in the LEB128 varint encoding of value
+  static unsigned int varintSize(unsigned long value);
+
 
     //Serializes the given data object into and writes it to a given buffer
   virtual void serialize(DataPtr obj, StreamBuffer * buffer) const=0;
+
+  // Returns the exact number of bytes that serialize() writes for the given data object, so that
+  // senders can allocate their outgoing buffer once at the right size before serializing into it
+  virtual unsigned int serializedSize(DataPtr obj) const=0;
   
   // Reads the serialized representation of a Data object from the stream, 
   // creates a binary representation of the object and returns a shared pointer to it.
   virtual DataPtr deserialize(FILE* in) const=0;
 
   virtual DataPtr deserialize(StreamBuffer * in) const=0;
+
+  // Reads an object in the encoding of the FILE* path from the buffer, so that files can be decoded in place
+  // (e.g. from a memory mapping). The two encodings only differ for schemas with stream-only encodings
+  // (dictionaries, chunks, compact and delta histograms) and for schemas that contain them, which override this.
+  virtual DataPtr deserializeFile(StreamBuffer * in) const { return deserialize(in); }
+
+  // Objects can also be streamed as frames: a header holding the length of the serialized object
+  // and the fingerprint of its schema, followed by the serialized object. Readers can then tell whether
+  // a whole object has arrived before decoding any of it.
+  static const int frameHeaderSize = sizeof(unsigned int) + sizeof(unsigned long long);
+
+  // Returns a 64-bit fingerprint of the structure of this schema. It is the same for structurally
+  // equal schemas in every process, so frames are tagged with it and schemas can be checked for
+  // compatibility by comparing fingerprints rather than walking them with operator==.
+  // It is computed on the first call, after which the structure of the schema may not change.
+  unsigned long long fingerprint() const;
+
+  // Serializes the given data object as one frame tagged with the given schema fingerprint.
+  // objSize must be serializedSize(obj), which callers usually already computed to size the buffer.
+  void serializeFrame(DataPtr obj, unsigned int objSize, unsigned long long fingerprint, StreamBuffer * buffer) const;
+
+  // Deserializes the next frame from the stream if all of it is available. Otherwise returns NULLData
+  // and leaves the stream untouched, so it can be called again once more bytes have arrived.
+  DataPtr deserializeFrame(unsigned long long fingerprint, StreamBuffer * in) const;
   	
   // Write a human-readable string representation of this object to the given
   // output stream
@@ -123,6 +242,16 @@ class Schema {
   // a schema, this method makes it possible to get its configuration.
   virtual SchemaConfigPtr getConfig() const=0;
 
+  // Returns whether deserializing objects from a StreamBuffer changes the state of this schema (e.g. the strings
+  // of a dictionary or the last histogram of a delta-encoded stream), in which case objects must be deserialized
+  // one at a time in stream order. Files hold neither, so objects read from a FILE* never depend on earlier ones.
+  virtual bool hasStreamState() const { return false; }
+
+  protected:
+  // fingerprint(), or 0 if it has not been computed yet
+  mutable unsigned long long fingerprintCache;
+  public:
+
 /*  // Maps unique names of schema types to pointers to their respective Schema objects
   static std::map<std::string, SchemaPtr> schemas;
 
@@ -155,6 +284,44 @@ class SchemaRegistry {
   static SchemaPtr create(propertiesPtr props);
 }; // SchemaRegistry
 
+// Fixed-layout codec that RecordSchema::finalize() compiles for records whose fields are all fixed-width
+// scalars. Such a record is serialized as one block of size bytes with each field at a precomputed offset.
+class FixedLayoutCodec {
+  public:
+  // Whether the record has a fixed layout. If not, the other members are empty.
+  bool fixed;
+  unsigned int size;
+  // Offset and ScalarSchema::scalarType of each field, indexed like RecordSchema::field2Idx
+  std::vector<unsigned int> offsets;
+  std::vector<int> types;
+
+  FixedLayoutCodec() : fixed(false), size(0) {}
+}; // class FixedLayoutCodec
+typedef boost::shared_ptr<const FixedLayoutCodec> FixedLayoutCodecPtr;
+
+// Process-wide cache of compiled codecs keyed by the fingerprint of the schema they were compiled for,
+// so that each structure is compiled once per process however many schema objects describe it.
+// Unlike the SchemaRegistry it is shared by all threads.
+class CodecCache {
+  public:
+  // Returns the codec compiled for the given fingerprint, or an empty pointer if there is none
+  static FixedLayoutCodecPtr get(unsigned long long fingerprint);
+
+  // Caches codec for the given fingerprint and returns it, or returns the codec that another thread
+  // cached for it first
+  static FixedLayoutCodecPtr add(unsigned long long fingerprint, FixedLayoutCodecPtr codec);
+}; // CodecCache
+
+// Process-wide pool of threads that deserializers use to decode independent parts of a large object in
+// parallel. Its threads are started on first use, one fewer than the number of cores, and live as long
+// as the process. Like the CodecCache it is shared by all threads.
+class DecodePool {
+  public:
+  // Calls task(0), ..., task(numTasks-1) on the threads of the pool and on the calling thread, which
+  // helps until all of them have been started, and returns once they have all finished
+  static void run(unsigned int numTasks, const boost::function<void(unsigned int)>& task);
+}; // DecodePool
+
 // Schemas need to be serialized and deserialized. The structure of Schemas is managed by SchemaConfig objects. 
 //   For each class that derives from Schema 
 //   there should be a corresponding Config class that derives from SchemaConfig. Each constructor of
@@ -225,12 +392,16 @@ class TupleSchema: public Schema, public boost::enable_shared_from_this<TupleSch
 
   // Serializes the given data object into and writes it to the given outgoing stream buffer
   void serialize(DataPtr obj, StreamBuffer * buffer) const;
+
+  // Returns the number of bytes serialize() writes for the given data object
+  unsigned int serializedSize(DataPtr obj) const;
   
   // Reads the serialized representation of a Data object from the stream, 
   // creates a binary representation of the object and returns a shared pointer to it.
   DataPtr deserialize(FILE* in) const;
 
   DataPtr deserialize(StreamBuffer * in) const;
+  DataPtr deserializeFile(StreamBuffer * in) const;
   	
   // Write a human-readable string representation of this object to the given
   // output stream
@@ -240,6 +411,8 @@ class TupleSchema: public Schema, public boost::enable_shared_from_this<TupleSch
   // can be created without creating a full schema (more expensive) but if we already have
   // a schema, this method makes it possible to get its configuration.
   SchemaConfigPtr getConfig() const;
+
+  bool hasStreamState() const;
 }; // class TupleSchema
 typedef SharedPtr<TupleSchema> TupleSchemaPtr;
 typedef SharedPtr<const TupleSchema> ConstTupleSchemaPtr;
@@ -257,6 +430,7 @@ typedef SharedPtr<TupleSchemaConfig> TupleSchemaConfigPtr;
  ******************/
 
 // Schema for named records, which maps string names to DataPtr values
+class Record;
 class RecordSchemaConfig;
 class RecordSchema: public Schema, public boost::enable_shared_from_this<RecordSchema> {
   friend class RecordSchemaConfig;
@@ -271,6 +445,15 @@ class RecordSchema: public Schema, public boost::enable_shared_from_this<RecordS
   
   // Records whether this schema's structure has been finalized (i.e. nothing else may be added) or not
   bool schemaFinalized;
+
+  // Fixed-layout codec compiled by finalize(), or taken from the CodecCache if a schema of the same
+  // structure was finalized before. When all the fields are fixed-width scalars a record is serialized
+  // as one block of fixedSize bytes with each field at a precomputed offset, so that serialize()/deserialize()
+  // move it with a single write/read instead of walking rFields.
+  // The block is byte-identical to the output of the generic per-field path.
+  FixedLayoutCodecPtr layout;
+  bool fixedLayout;
+  unsigned int fixedSize;
   
   // Loads the RecordSchema from a configuration file. add() or finalize() may not be called after this constructor.
   RecordSchema(properties::iterator props);
@@ -300,6 +483,9 @@ class RecordSchema: public Schema, public boost::enable_shared_from_this<RecordS
   unsigned int getIdx(const std::string& label) const;
   
   const std::map<std::string, SchemaPtr>& getFields() const { return rFields; }
+
+  // Returns whether finalize() compiled a fixed-layout codec for this schema
+  bool isFixedLayout() const { return fixedLayout; }
   	
   // Return whether this object is identical to that object
   bool operator==(const SchemaPtr& that_arg) const;
@@ -313,12 +499,16 @@ class RecordSchema: public Schema, public boost::enable_shared_from_this<RecordS
 
   // Serializes the given data object into and writes it to the given outgoing stream buffer
   void serialize(DataPtr obj, StreamBuffer * buffer) const;
+
+  // Returns the number of bytes serialize() writes for the given data object
+  unsigned int serializedSize(DataPtr obj) const;
   
   // Reads the serialized representation of a Data object from the stream, 
   // creates a binary representation of the object and returns a shared pointer to it.
   DataPtr deserialize(FILE* in) const;
 
   DataPtr deserialize(StreamBuffer * in) const;
+  DataPtr deserializeFile(StreamBuffer * in) const;
 
     // Write a human-readable string representation of this object to the given
   // output stream
@@ -328,6 +518,19 @@ class RecordSchema: public Schema, public boost::enable_shared_from_this<RecordS
   // can be created without creating a full schema (more expensive) but if we already have
   // a schema, this method makes it possible to get its configuration.
   SchemaConfigPtr getConfig() const;
+
+  bool hasStreamState() const;
+
+  protected:
+  // Sets layout, fixedLayout and fixedSize from the cached codec for this structure, compiling it if needed
+  void compileLayout();
+
+  // Copies the fields of the given record into the fixedSize bytes at block
+  void packFixed(const Record* obj, char* block) const;
+
+  // Creates a lazy record with room for a fixedSize byte block, which the caller fills in.
+  // Its fields are decoded from the block on demand.
+  SharedPtr<Record> newLazyRecord() const;
 }; // class RecordSchema
 typedef SharedPtr<RecordSchema> RecordSchemaPtr;
 typedef SharedPtr<const RecordSchema> ConstRecordSchemaPtr;
@@ -360,9 +563,14 @@ class KeyValSchema: public Schema, public boost::enable_shared_from_this<KeyValS
   SchemaPtr key;
   SchemaPtr value;
 
+  // If non-zero, derived schemas that support it serialize their keys on StreamBuffers in chunks of
+  // chunkKeys keys, preceded by a table of the size of each chunk, so that receivers can decode the
+  // chunks in parallel on the DecodePool. Files always use the unchunked layout.
+  unsigned int chunkKeys;
+
   KeyValSchema();
 
-  KeyValSchema(const SchemaPtr& key, const SchemaPtr& value);
+  KeyValSchema(const SchemaPtr& key, const SchemaPtr& value, unsigned int chunkKeys=0);
   
   // Loads the Schema from a configuration file. add() or finalize() may not be called after this constructor.
   KeyValSchema(properties::iterator props);
@@ -380,6 +588,26 @@ class KeyValSchema: public Schema, public boost::enable_shared_from_this<KeyValS
   // Write a human-readable string representation of this object to the given
   // output stream
   std::ostream& str(std::ostream& out) const;
+
+  bool hasStreamState() const { return key->hasStreamState() || value->hasStreamState(); }
+
+  protected:
+  // Returns the number of chunks that numKeys keys are split into
+  unsigned int numChunks(unsigned int numKeys) const { return (chunkKeys == 0 ? 0 : (numKeys + chunkKeys - 1) / chunkKeys); }
+
+  // Writes the keys of data and their values in chunks of chunkKeys keys, preceded by the table of the
+  // chunks' sizes. If withCounts each key is followed by its number of values, otherwise it must have one.
+  void serializeChunks(const std::map<DataPtr, std::list<DataPtr> >& data, bool withCounts, StreamBuffer * buffer) const;
+
+  // Reads the numKeys keys and values written by serializeChunks() into data, decoding the chunks in
+  // parallel unless there is only one or the key or value schema has stream state.
+  // Returns false if they are not all in the buffer yet.
+  bool deserializeChunks(unsigned int numKeys, bool withCounts, std::map<DataPtr, std::list<DataPtr> >& data,
+                         StreamBuffer * in) const;
+
+  // Decodes the numKeys keys and values of the size bytes of one chunk into entries
+  void deserializeChunk(const char* chunk, unsigned int size, unsigned int numKeys, bool withCounts,
+                        std::vector<std::pair<DataPtr, std::list<DataPtr> > >& entries) const;
 }; // class KeyValSchema
 typedef SharedPtr<KeyValSchema> KeyValSchemaPtr;
 typedef SharedPtr<const KeyValSchema> ConstKeyValSchemaPtr;
@@ -399,8 +627,8 @@ class KeyValSchemaConfig: public SchemaConfig {
 // that keeps it as a list of key->value pairs.
 class ExplicitKeyValSchema : public KeyValSchema {
   public:
-  ExplicitKeyValSchema(const SchemaPtr& key, const SchemaPtr& value) : 
-  	KeyValSchema(key, value) {}
+  ExplicitKeyValSchema(const SchemaPtr& key, const SchemaPtr& value, unsigned int chunkKeys=0) : 
+  	KeyValSchema(key, value, chunkKeys) {}
   
   // Loads the Schema from a configuration file. add() or finalize() may not be called after this constructor.
   ExplicitKeyValSchema(properties::iterator props);
@@ -414,11 +642,15 @@ class ExplicitKeyValSchema : public KeyValSchema {
   // Serializes the given data object into and writes it to the given outgoing stream buffer
   void serialize(DataPtr obj, StreamBuffer * buffer) const;
 
+  // Returns the number of bytes serialize() writes for the given data object
+  unsigned int serializedSize(DataPtr obj) const;
+
   // Reads the serialized representation of a Data object from the stream, 
   // creates a binary representation of the object and returns a shared pointer to it.
   DataPtr deserialize(FILE* in) const;
 
   DataPtr deserialize(StreamBuffer * in) const;
+  DataPtr deserializeFile(StreamBuffer * in) const;
 
     // Write a human-readable string representation of this object to the given
   // output stream
@@ -434,26 +666,91 @@ typedef SharedPtr<const ExplicitKeyValSchema> ConstExplicitKeyValSchemaPtr;
 
 class ExplicitKeyValSchemaConfig: public KeyValSchemaConfig {
   public:
-  ExplicitKeyValSchemaConfig(const SchemaConfigPtr& key, const SchemaConfigPtr& value, propertiesPtr props=NULLProperties);
+  ExplicitKeyValSchemaConfig(const SchemaConfigPtr& key, const SchemaConfigPtr& value, unsigned int chunkKeys=0,
+                             propertiesPtr props=NULLProperties);
     
-  propertiesPtr setProperties(const SchemaConfigPtr& key, const SchemaConfigPtr& value, propertiesPtr props);
+  propertiesPtr setProperties(const SchemaConfigPtr& key, const SchemaConfigPtr& value, unsigned int chunkKeys, propertiesPtr props);
 }; // class ExplicitKeyValSchemaConfig
 
 /******************
  ***** Scalar *****
  ******************/
 
+// State of a dictionary-encoded string stream, used on the StreamBuffer path only. The first time a string is sent it is written in full and both
+// sides give it the next id, after which it is sent as just its varint id. Each string is serialized as a varint
+// tag: 0 for a string written in full, followed by its varint length and its characters, or 1 + the string's id.
+//
+// serializedSize() has to predict exactly what serialize() will write, even for objects that hold the same new
+// string more than once. So once sizes have been predicted, the strings that serialize() writes in full are
+// staged and only added to the dictionary when the size of the next object is predicted. Every string written
+// in full takes an id, so receivers just append it to their table.
+class StringDictionary {
+public:
+    // Sender side: the ids of the strings that the receiver knows and the id of the next string written in full
+    std::unordered_map<std::string, unsigned long> ids;
+    unsigned long nextId;
+    // Strings written in full since the sender last added staged strings to ids
+    std::vector<std::string> staged;
+    // Whether sizes have been predicted at all, and whether an object has been written since the last prediction
+    bool predicted, written;
+
+    // Receiver side: the strings received so far, indexed by id. Every reference to a string returns the same
+    // Scalar<string>, so objects decoded from the stream share these and must not modify them.
+    std::vector<DataPtr> strings;
+
+    StringDictionary() : nextId(0), predicted(false), written(false) {}
+
+    // Returns the number of bytes that encode() will write for s
+    unsigned int size(const std::string& s);
+
+    // Writes s to the buffer as a full string or as its id
+    void encode(const std::string& s, StreamBuffer * buffer);
+
+    // Called by encode() after s was written in full
+    void sentFull(const std::string& s);
+}; // class StringDictionary
+
 // Schemas of scalars of various base types
 class ScalarSchemaConfig;
 class ScalarSchema: public Schema, public boost::enable_shared_from_this<ScalarSchema> {
   friend class ScalarSchemaConfig;
   
   public:
-  typedef enum {charT, stringT, intT, longT, floatT, doubleT} scalarType;
+  // The C++ types that hold scalars of each type in memory are:
+  //   charT: char, stringT: std::string, intT: int, longT: long, floatT: float, doubleT: double,
+  //   int8T: signed char, int16T: short, uint16T: unsigned short, uint32T: unsigned int, uint64T: unsigned long,
+  //   boolT: bool, halfT: float, which is serialized as a 16-bit IEEE half-precision float.
+  // New types are added at the end since configurations record types by their number.
+  typedef enum {charT, stringT, intT, longT, floatT, doubleT,
+                int8T, int16T, uint16T, uint32T, uint64T, boolT, halfT} scalarType;
+
+  // Lossy encodings of doubles that are accurate to within errorBound:
+  //   absoluteQuantization - values are rounded to multiples of 2*errorBound and sent as the zigzag varint of
+  //                          1 + the multiple. 0 is followed by the raw double, for values too large to quantize.
+  //   relativeQuantization - the mantissa is rounded to as many bits as errorBound requires, for a relative error
+  //                          of at most errorBound on normal values, and the sign, exponent and the rounded
+  //                          mantissa are sent in the fewest whole bytes that hold them (3 bytes for 1e-3)
+  typedef enum {noQuantization=0, absoluteQuantization=1, relativeQuantization=2} quantizationType;
   private:
   scalarType type;
+  quantizationType quantization;
+  double errorBound;
+  // Multiple that absolutely quantized values are rounded to
+  double step;
+  // Number of mantissa bits and of bytes in relatively quantized values
+  unsigned int mantissaBits, quantizedBytes;
+  // Whether strings are dictionary-encoded on the StreamBuffer path (see StringDictionary). Files hold plain
+  // strings. The dictionary lives in the schema, so each stream, and each field of a record, needs a schema object
+  // of its own on both the sending and the receiving side.
+  bool dictionary;
+  mutable StringDictionary dict;
+
+  // Reads a NUL-terminated string if all of it is available
+  static DataPtr deserializePlainString(StreamBuffer * in);
   public:
-  ScalarSchema(scalarType type);
+  ScalarSchema(scalarType type, bool dictionary=false);
+  // Schema of doubles that are quantized to within errorBound
+  ScalarSchema(scalarType type, quantizationType quantization, double errorBound);
   ScalarSchema(properties::iterator props);
     
   // Creates an instance of the schema from its serialized representation
@@ -476,22 +773,69 @@ class ScalarSchema: public Schema, public boost::enable_shared_from_this<ScalarS
   //returns size of the data written into buffer
   void serialize(DataPtr obj, StreamBuffer * buffer) const;
 
+  // Returns the number of bytes serialize() writes for the given data object
+  unsigned int serializedSize(DataPtr obj) const;
+
     // Reads the serialized representation of a Data object from the stream,
   // creates a binary representation of the object and returns a shared pointer to it.
   DataPtr deserialize(FILE* in) const;
 
   DataPtr deserialize(StreamBuffer * in) const;
+  DataPtr deserializeFile(StreamBuffer * in) const;
 
 
     // Returns this Schema's scalar type
   scalarType getType() const { return type; }
 
+  // Returns whether strings are dictionary-encoded
+  bool isDictionary() const { return dictionary; }
+
+  // Returns whether doubles are quantized, in which case their serialized form varies in size
+  bool isQuantized() const { return quantization != noQuantization; }
+  quantizationType getQuantization() const { return quantization; }
+  double getErrorBound() const { return errorBound; }
+
   // Returns a string representation of this schema's type
   static std::string type2Str(scalarType type);
   
   // String representation of this Schema's scalar type
   std::string type2Str() const { return type2Str(getType()); }
 
+  // Returns the number of bytes in the serialized form of scalars of the given type,
+  // or 0 if it varies from value to value (strings)
+  static unsigned int fixedWidth(scalarType type);
+
+  // Copies the value of the given fixed-width scalar into the fixedWidth(type) bytes at dst
+  static void packFixed(scalarType type, const Data* obj, char* dst);
+
+  // Creates a fixed-width scalar from the fixedWidth(type) bytes at src
+  static DataPtr unpackFixed(scalarType type, const char* src);
+
+  // Returns the value of the given numeric scalar as a double
+  static double toDouble(scalarType type, const Data* obj);
+
+  // Returns whether obj is a Scalar of the C++ type that holds scalars of the given type
+  static bool isCompatible(scalarType type, const Data* obj);
+
+  // Conversions between floats and the bits of IEEE half-precision floats, rounding to the nearest half
+  static unsigned short floatToHalf(float value);
+  static float halfToFloat(unsigned short half);
+
+  private:
+  // Checks the quantization settings and derives step, mantissaBits and quantizedBytes from them
+  void initQuantization();
+
+  // Writes the quantized form of value into bytes, which must have room for maxQuantizedSize bytes.
+  // Returns the number of bytes written.
+  static const unsigned int maxQuantizedSize = 1 + sizeof(double);
+  unsigned int quantize(double value, char* bytes) const;
+
+  // Reads a quantized value from the size bytes at bytes. Returns the number of bytes read,
+  // or 0 if the value is not complete.
+  unsigned int dequantize(const char* bytes, unsigned int size, double* value) const;
+
+  public:
+
   // Write a human-readable string representation of this object to the given
   // output stream
   std::ostream& str(std::ostream& out) const;
@@ -500,16 +844,99 @@ class ScalarSchema: public Schema, public boost::enable_shared_from_this<ScalarS
   // can be created without creating a full schema (more expensive) but if we already have
   // a schema, this method makes it possible to get its configuration.
   SchemaConfigPtr getConfig() const;
+
+  bool hasStreamState() const { return dictionary; }
 }; // class ScalarSchema
 typedef SharedPtr<ScalarSchema> ScalarSchemaPtr;
 
 class ScalarSchemaConfig: public SchemaConfig {
   public:
-  ScalarSchemaConfig(ScalarSchema::scalarType type, propertiesPtr props=NULLProperties);
+  ScalarSchemaConfig(ScalarSchema::scalarType type, bool dictionary=false,
+                     ScalarSchema::quantizationType quantization=ScalarSchema::noQuantization, double errorBound=0,
+                     propertiesPtr props=NULLProperties);
     
-  propertiesPtr setProperties(ScalarSchema::scalarType type, propertiesPtr props);
+  propertiesPtr setProperties(ScalarSchema::scalarType type, bool dictionary,
+                              ScalarSchema::quantizationType quantization, double errorBound, propertiesPtr props);
 }; // class ScalarSchemaConfig
 
+/***********************
+ ***** RecordBatch *****
+ ***********************/
+
+// Schema for batches of records that share a RecordSchema, stored as one contiguous column per field
+// (see RecordBatch). The record schema must have a fixed layout, so that every column holds fixed-width values.
+// A batch is serialized as the number of records in it, followed by each column in field2Idx order, which
+// is written and read with one memcpy per column rather than one per value.
+class RecordBatch;
+class RecordBatchSchemaConfig;
+class RecordBatchSchema: public Schema, public boost::enable_shared_from_this<RecordBatchSchema> {
+  friend class RecordBatchSchemaConfig;
+
+  public:
+  // The schema of each record in the batch
+  RecordSchemaPtr record;
+
+  RecordBatchSchema(RecordSchemaPtr record);
+
+  // Loads the RecordBatchSchema from a configuration file
+  RecordBatchSchema(properties::iterator props);
+
+  // Creates an instance of the schema from its serialized representation
+  static SchemaPtr create(properties::iterator props);
+
+  // Returns the number of columns in batches of this schema
+  unsigned int numColumns() const { return record->layout->types.size(); }
+
+  // Returns the ScalarSchema::scalarType of the values in the given column
+  ScalarSchema::scalarType columnType(unsigned int idx) const { return (ScalarSchema::scalarType)record->layout->types[idx]; }
+
+  // Returns the number of bytes of each value in the given column
+  unsigned int columnWidth(unsigned int idx) const;
+
+  // Return whether this object is identical to that object
+  bool operator==(const SchemaPtr& that_arg) const;
+
+  // Return whether this object is strictly less than that object
+  // that must have a name that is compatible with this
+  bool operator<(const SchemaPtr& that_arg) const;
+
+  // Serializes the given data object into and writes it to the given outgoing stream
+  void serialize(DataPtr obj, FILE* out) const;
+
+  // Serializes the given data object into and writes it to the given outgoing stream buffer
+  void serialize(DataPtr obj, StreamBuffer * buffer) const;
+
+  // Returns the number of bytes serialize() writes for the given data object
+  unsigned int serializedSize(DataPtr obj) const;
+
+  // Reads the serialized representation of a Data object from the stream,
+  // creates a binary representation of the object and returns a shared pointer to it.
+  DataPtr deserialize(FILE* in) const;
+
+  DataPtr deserialize(StreamBuffer * in) const;
+
+  // Write a human-readable string representation of this object to the given
+  // output stream
+  std::ostream& str(std::ostream& out) const;
+
+  // Returns the Schema configuration object that describes this schema. Such configurations
+  // can be created without creating a full schema (more expensive) but if we already have
+  // a schema, this method makes it possible to get its configuration.
+  SchemaConfigPtr getConfig() const;
+
+  bool hasStreamState() const { return record->hasStreamState(); }
+}; // class RecordBatchSchema
+typedef SharedPtr<RecordBatchSchema> RecordBatchSchemaPtr;
+typedef SharedPtr<const RecordBatchSchema> ConstRecordBatchSchemaPtr;
+
+class RecordBatchSchemaConfig: public SchemaConfig {
+  public:
+  RecordBatchSchemaConfig(const SchemaConfigPtr& record, propertiesPtr props=NULLProperties);
+
+  propertiesPtr setProperties(const SchemaConfigPtr& record, propertiesPtr props);
+}; // class RecordBatchSchemaConfig
+typedef SharedPtr<RecordBatchSchemaConfig> RecordBatchSchemaConfigPtr;
+
 
 /*******************************
 ***** Histogram Bin Schema *****
@@ -546,11 +973,15 @@ public:
     // Serializes the given data object into and writes it to the given outgoing stream buffer
     void serialize(DataPtr obj, StreamBuffer * buffer) const;
 
+    // Returns the number of bytes serialize() writes for the given data object
+    unsigned int serializedSize(DataPtr obj) const;
+
     // Reads the serialized representation of a Data object from the stream,
     // creates a binary representation of the object and returns a shared pointer to it.
     DataPtr deserialize(FILE* in) const;
 
     DataPtr deserialize(StreamBuffer * in) const;
+    DataPtr deserializeFile(StreamBuffer * in) const;
 
     // Write a human-readable string representation of this object to the given
     // output stream
@@ -586,17 +1017,58 @@ typedef SharedPtr<HistogramBinSchemaConfig> HistogramBinSchemaConfigPtr;
 *            val :  [ HistogramBinSchema ]
 *
 */
+class Histogram;
+
+// The bins of the last histogram sent or received on a delta-encoded histogram stream
+class HistogramSnapshot {
+public:
+    bool valid;
+    double min, max;
+    std::vector<double> starts, ends;
+    std::vector<int> counts;
+
+    HistogramSnapshot() : valid(false) {}
+
+    // Records the range and bins of obj. The snapshot is left invalid if obj has a key that
+    // maps to several bins or to a bin that does not start at the key.
+    void take(Histogram* obj);
+
+    // Returns whether that has the same range and bin boundaries as this snapshot
+    bool sameBins(const HistogramSnapshot& that) const;
+}; // class HistogramSnapshot
+
 // Schema for an explicit representation of key->value mappings (ExplicitKeyValMap)
 // that keeps it as a list of key->value pairs.
 class HistogramSchema : public KeyValSchema {
 public:
+    // Layouts of serialized histograms on streams
+    // - genericEnc: min, max, the number of bins, then the key and all the fields of each bin
+    // - compactEnc: histograms whose bins are laid out regularly from min with a fixed width (as
+    //   SynchedRecordJoinOperator produces them) are sent as min, max and width followed by varint
+    //   bin counts, with runs of empty bins collapsed. Other histograms fall back to genericEnc.
+    //   Each histogram is preceded by a byte that records which of the two was used.
+    typedef enum {genericEnc, compactEnc} encodingType;
+
     //schemas for min-max range
     ScalarSchemaPtr min;
     ScalarSchemaPtr max;
 
     //key/value is inherited from KeyValSchema
 
-    HistogramSchema() ;
+    // Layout used by serialize()/deserialize() on StreamBuffers. Files always use genericEnc.
+    encodingType encoding;
+
+    // If non-zero, each histogram serialized on a StreamBuffer may be sent as a delta: the count changes
+    // of its bins relative to the previous histogram serialized by this schema, which the receiving
+    // schema adds to the previous histogram it deserialized. A delta is only sent when the range and bin
+    // boundaries did not change and it is smaller than the full histogram, and a full histogram is sent
+    // at least once every deltaInterval histograms. Each histogram is preceded by a byte that records
+    // whether it is a full histogram or a delta. The delta state is per schema object, so each sender
+    // and receiver of a delta-encoded stream needs a schema object of its own.
+    unsigned int deltaInterval;
+
+    // chunkKeys (see KeyValSchema) applies to the generic layout
+    HistogramSchema(encodingType encoding=genericEnc, unsigned int deltaInterval=0, unsigned int chunkKeys=0) ;
 
     // Loads the Schema from a configuration file. add() or finalize() may not be called after this constructor.
     HistogramSchema(properties::iterator props);
@@ -610,11 +1082,15 @@ public:
     // Serializes the given data object into and writes it to the given outgoing stream buffer
     void serialize(DataPtr obj, StreamBuffer * buffer) const;
 
+    // Returns the number of bytes serialize() writes for the given data object
+    unsigned int serializedSize(DataPtr obj) const;
+
     // Reads the serialized representation of a Data object from the stream,
     // creates a binary representation of the object and returns a shared pointer to it.
     DataPtr deserialize(FILE* in) const;
 
     DataPtr deserialize(StreamBuffer * in) const;
+    DataPtr deserializeFile(StreamBuffer * in) const;
 
     // Write a human-readable string representation of this object to the given
     // output stream
@@ -624,6 +1100,37 @@ public:
     // can be created without creating a full schema (more expensive) but if we already have
     // a schema, this method makes it possible to get its configuration.
     SchemaConfigPtr getConfig() const;
+
+    bool hasStreamState() const;
+
+protected:
+    // Records whether the min/max/key/value schemas have the types that compactEnc supports:
+    // doubles for min, max, key and bin boundaries and an int bin count
+    bool compactSupported;
+
+    void initEncoding();
+
+    // Computes the compactEnc form of obj: the bin width, the number of bin slots from min up
+    // to the last bin, and the varint tokens that describe the slots.
+    // Returns false if the bins of obj are not laid out regularly enough to be encoded this way.
+    bool compactTokens(Histogram* obj, double& width, unsigned long& numSlots, std::vector<unsigned long>& tokens) const;
+
+    DataPtr deserializeCompact(StreamBuffer * in) const;
+
+    // The full forms of serialize(), serializedSize() and deserialize() on StreamBuffers
+    void serializeFull(Histogram* obj, StreamBuffer * buffer) const;
+    unsigned int serializedSizeFull(Histogram* obj) const;
+    DataPtr deserializeFull(StreamBuffer * in) const;
+
+    // Delta encoding state: the last histogram serialized and deserialized by this schema and the
+    // number of histograms serialized since the last full one
+    mutable HistogramSnapshot lastSent;
+    mutable HistogramSnapshot lastReceived;
+    mutable unsigned int sinceFull;
+
+    // Computes the delta of cur against lastSent as varint tokens. Returns false if a full
+    // histogram should be sent instead.
+    bool deltaTokens(Histogram* obj, const HistogramSnapshot& cur, std::vector<unsigned long>& tokens) const;
 }; // class ExplicitKeyValSchema
 typedef SharedPtr<HistogramSchema> HistogramSchemaPtr;
 typedef SharedPtr<const HistogramSchema> ConstHistogramSchemaPtr;
@@ -636,10 +1143,14 @@ typedef SharedPtr<const HistogramSchema> ConstHistogramSchemaPtr;
 class HistogramSchemaConfig: public SchemaConfig {
 public:
     HistogramSchemaConfig(const SchemaConfigPtr& min, const SchemaConfigPtr& max,
-            const SchemaConfigPtr& key, const SchemaConfigPtr& value, propertiesPtr props=NULLProperties);
+            const SchemaConfigPtr& key, const SchemaConfigPtr& value,
+            HistogramSchema::encodingType encoding=HistogramSchema::genericEnc, unsigned int deltaInterval=0,
+            unsigned int chunkKeys=0, propertiesPtr props=NULLProperties);
 
     propertiesPtr setProperties(const SchemaConfigPtr& min, const SchemaConfigPtr& max,
-            const SchemaConfigPtr& key, const SchemaConfigPtr& value, propertiesPtr props);
+            const SchemaConfigPtr& key, const SchemaConfigPtr& value,
+            HistogramSchema::encodingType encoding, unsigned int deltaInterval, unsigned int chunkKeys,
+            propertiesPtr props);
 }; // class RecordSchemaConfig
 typedef SharedPtr<HistogramSchemaConfig> HistogramSchemaConfigPtr;
 
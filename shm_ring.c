@@ -0,0 +1,190 @@
+#include "shm_ring.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Each side only writes its own counter, reading the other's with acquire semantics so that the bytes
+ * of a message are visible before the counter that publishes or releases it */
+#define LOAD(p)     __atomic_load_n(p, __ATOMIC_ACQUIRE)
+#define STORE(p, v) __atomic_store_n(p, v, __ATOMIC_RELEASE)
+
+static size_t align8(size_t size) { return (size + 7) & ~(size_t) 7; }
+
+/* Backs off while the other side catches up: spins briefly, then yields and finally sleeps, so that an idle
+ * consumer does not take a core away from the simulation */
+static void backoff(unsigned* spins) {
+  ++*spins;
+  if(*spins < 64) return;
+  if(*spins < 128) { sched_yield(); return; }
+  struct timespec pause = { 0, 50000 };
+  nanosleep(&pause, NULL);
+}
+
+static flow_shm_ring* map(int fd, size_t mappingSize) {
+  void* mapping = mmap(NULL, mappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if(mapping == MAP_FAILED) return NULL;
+
+  flow_shm_ring* ring = (flow_shm_ring*) malloc(sizeof(flow_shm_ring));
+  ring->header = (flow_shm_header*) mapping;
+  ring->data = (char*) mapping + sizeof(flow_shm_header);
+  ring->mappingSize = mappingSize;
+  ring->pending = 0;
+  return ring;
+}
+
+/********************
+ ***** Producer *****
+ ********************/
+
+flow_shm_ring* flow_shm_create(const char* name, size_t capacity) {
+  capacity = align8(capacity);
+  if(capacity < 2 * sizeof(flow_shm_message)) { errno = EINVAL; return NULL; }
+
+  shm_unlink(name);
+  int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+  if(fd < 0) return NULL;
+  size_t mappingSize = sizeof(flow_shm_header) + capacity;
+  if(ftruncate(fd, mappingSize) != 0) { int err = errno; close(fd); shm_unlink(name); errno = err; return NULL; }
+
+  flow_shm_ring* ring = map(fd, mappingSize);
+  int err = errno;
+  close(fd);
+  if(!ring) { shm_unlink(name); errno = err; return NULL; }
+
+  /* The segment starts out zeroed. The magic number is written last, once the consumer may use the ring. */
+  ring->header->capacity = capacity;
+  STORE(&ring->header->magic, FLOW_SHM_MAGIC);
+  return ring;
+}
+
+/* Waits until the ring has room for size more bytes after head */
+static void waitForRoom(flow_shm_ring* ring, uint64_t head, size_t size) {
+  unsigned spins = 0;
+  while(head + size - LOAD(&ring->header->tail) > ring->header->capacity) backoff(&spins);
+}
+
+void* flow_shm_reserve(flow_shm_ring* ring, size_t size) {
+  flow_shm_header* header = ring->header;
+  size_t len = align8(sizeof(flow_shm_message) + size);
+  if(len > header->capacity || size > UINT32_MAX) return NULL;
+
+  uint64_t head = header->head;
+  size_t offset = head % header->capacity;
+  /* Messages are contiguous, so one that does not fit before the end of the ring starts over at its front */
+  if(offset + len > header->capacity) {
+    size_t pad = header->capacity - offset;
+    waitForRoom(ring, head, pad);
+    flow_shm_message* wrap = (flow_shm_message*) (ring->data + offset);
+    wrap->size = pad - sizeof(flow_shm_message);
+    wrap->flags = FLOW_SHM_WRAP;
+    head += pad;
+    STORE(&header->head, head);
+    offset = 0;
+  }
+
+  waitForRoom(ring, head, len);
+  ring->pending = len;
+  return ring->data + offset + sizeof(flow_shm_message);
+}
+
+void flow_shm_commit(flow_shm_ring* ring, size_t size) {
+  flow_shm_header* header = ring->header;
+  size_t len = align8(sizeof(flow_shm_message) + size);
+  assert(len <= ring->pending);
+
+  flow_shm_message* msg = (flow_shm_message*) (ring->data + header->head % header->capacity);
+  msg->size = size;
+  msg->flags = 0;
+  STORE(&header->head, header->head + len);
+  ring->pending = 0;
+}
+
+int flow_shm_write(flow_shm_ring* ring, const void* data, size_t size) {
+  void* room = flow_shm_reserve(ring, size);
+  if(!room) return -1;
+  memcpy(room, data, size);
+  flow_shm_commit(ring, size);
+  return 0;
+}
+
+void flow_shm_close(flow_shm_ring* ring) {
+  STORE(&ring->header->closed, 1);
+  flow_shm_detach(ring);
+}
+
+/********************
+ ***** Consumer *****
+ ********************/
+
+static double elapsedMs(const struct timespec* start) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (now.tv_sec - start->tv_sec) * 1e3 + (now.tv_nsec - start->tv_nsec) / 1e6;
+}
+
+flow_shm_ring* flow_shm_attach(const char* name, int timeout_ms) {
+  struct timespec start, pause = { 0, 1000000 };
+  clock_gettime(CLOCK_MONOTONIC, &start);
+
+  /* The segment is usable once the producer has sized it and written its magic number */
+  for(;;) {
+    int fd = shm_open(name, O_RDWR, 0);
+    if(fd >= 0) {
+      struct stat st;
+      if(fstat(fd, &st) == 0 && (size_t) st.st_size > sizeof(flow_shm_header)) {
+        flow_shm_ring* ring = map(fd, st.st_size);
+        close(fd);
+        if(!ring) return NULL;
+        if(LOAD(&ring->header->magic) == FLOW_SHM_MAGIC) return ring;
+        flow_shm_detach(ring);
+      } else
+        close(fd);
+    }
+
+    if(timeout_ms >= 0 && elapsedMs(&start) >= timeout_ms) { errno = ETIMEDOUT; return NULL; }
+    nanosleep(&pause, NULL);
+  }
+}
+
+const void* flow_shm_next(flow_shm_ring* ring, size_t* size) {
+  flow_shm_header* header = ring->header;
+  unsigned spins = 0;
+  for(;;) {
+    uint64_t tail = header->tail;
+    if(LOAD(&header->head) == tail) {
+      /* The producer commits its last message before closing the ring, so the ring is drained if it is
+       * still empty once closed */
+      if(LOAD(&header->closed) && LOAD(&header->head) == tail) return NULL;
+      backoff(&spins);
+      continue;
+    }
+
+    flow_shm_message* msg = (flow_shm_message*) (ring->data + tail % header->capacity);
+    if(msg->flags & FLOW_SHM_WRAP) {
+      STORE(&header->tail, tail + sizeof(flow_shm_message) + msg->size);
+      continue;
+    }
+
+    *size = msg->size;
+    ring->pending = align8(sizeof(flow_shm_message) + msg->size);
+    return msg + 1;
+  }
+}
+
+void flow_shm_release(flow_shm_ring* ring) {
+  STORE(&ring->header->tail, ring->header->tail + ring->pending);
+  ring->pending = 0;
+}
+
+void flow_shm_detach(flow_shm_ring* ring) {
+  munmap(ring->header, ring->mappingSize);
+  free(ring);
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+/*
+* A single-producer single-consumer ring buffer in POSIX shared memory, through which a simulation hands
+* serialized Flow objects to a SharedMemInOperator running on the same node. This header is plain C so that
+* simulations written in C or Fortran can link against shm_ring.o without the rest of Flow.
+*
+* The producer writes messages into the ring in place: flow_shm_reserve() returns room for the next message
+* and flow_shm_commit() publishes it. The consumer decodes each message where it lies in the ring and then
+* releases it, so that messages are never copied through an intermediate buffer on either side.
+*
+* The payload of a message holds one or more objects serialized as the Schema of the consuming operator
+* serializes them. In particular:
+*   - a Record of fixed-width scalars is its fields packed back to back, without padding, in the
+*     alphabetical order of their names;
+*   - a RecordBatch of such records is the unsigned int number of records followed by one column per field,
+*     in the same order, each holding the values of that field for every record.
+*
+* Layout of the segment: a flow_shm_header followed by capacity bytes of messages. Each message starts
+* at a multiple of 8 bytes with a flow_shm_message header. A message that would straddle the end of the
+* ring is preceded by a wrap message that pads the ring to its end.
+* */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FLOW_SHM_MAGIC 0x314d4853574f4c46ULL /* "FLOWSHM1" */
+
+/* The position counters are kept on separate cache lines so that the two sides do not contend for them */
+typedef struct flow_shm_header {
+  uint64_t magic;
+  /* bytes of messages that follow the header, a multiple of 8 */
+  uint64_t capacity;
+  /* set by the producer once it has committed its last message */
+  uint32_t closed;
+  char pad0[44];
+  /* total number of bytes committed by the producer */
+  uint64_t head;
+  char pad1[56];
+  /* total number of bytes released by the consumer */
+  uint64_t tail;
+  char pad2[56];
+} flow_shm_header;
+
+typedef struct flow_shm_message {
+  /* bytes of payload that follow this header */
+  uint32_t size;
+  /* FLOW_SHM_WRAP if the rest of the ring is padding, otherwise 0 */
+  uint32_t flags;
+} flow_shm_message;
+
+#define FLOW_SHM_WRAP 1
+
+/* One side's mapping of a ring */
+typedef struct flow_shm_ring {
+  flow_shm_header* header;
+  char* data;
+  size_t mappingSize;
+  /* the producer's size of the reserved message, the consumer's size of the message it looks at */
+  size_t pending;
+} flow_shm_ring;
+
+/* Producer side */
+
+/* Creates the shared-memory segment with the given name (e.g. "/flow_rank0"), replacing any older segment
+ * of that name, with room for capacity bytes of messages. Returns NULL and sets errno on failure. */
+flow_shm_ring* flow_shm_create(const char* name, size_t capacity);
+
+/* Returns a pointer to size bytes in the ring into which the next message is written, waiting for the
+ * consumer to release older messages if the ring is full. Returns NULL if a message of size bytes can
+ * never fit in the ring. */
+void* flow_shm_reserve(flow_shm_ring* ring, size_t size);
+
+/* Publishes the message written into the room returned by the last flow_shm_reserve(), which may be
+ * shorter than the room that was reserved */
+void flow_shm_commit(flow_shm_ring* ring, size_t size);
+
+/* Copies size bytes into the ring as one message. Returns 0 on success and -1 if it can never fit. */
+int flow_shm_write(flow_shm_ring* ring, const void* data, size_t size);
+
+/* Marks the end of the stream and unmaps the ring. The consumer removes the segment with shm_unlink()
+ * once it has read every message. */
+void flow_shm_close(flow_shm_ring* ring);
+
+/* Consumer side */
+
+/* Maps the segment with the given name, waiting up to timeout_ms milliseconds (forever if negative)
+ * for the producer to create it. Returns NULL if it does not appear in time. */
+flow_shm_ring* flow_shm_attach(const char* name, int timeout_ms);
+
+/* Returns the payload of the oldest message that has not been released and sets *size to its size,
+ * waiting for the producer to commit one. Returns NULL once the producer has closed the ring and every
+ * message has been released. */
+const void* flow_shm_next(flow_shm_ring* ring, size_t* size);
+
+/* Releases the message returned by the last flow_shm_next(), whose room may then be reused */
+void flow_shm_release(flow_shm_ring* ring);
+
+/* Unmaps the ring */
+void flow_shm_detach(flow_shm_ring* ring);
+
+#ifdef __cplusplus
+}
+#endif